@@ -19,12 +19,29 @@
 #define MQTT_KEEPALIVE              30
 
 #define OPENTHERM_OFFLINE_TRESHOLD  10
+#define OPENTHERM_UNSUPPORTED_TRESHOLD  3
+#define OPENTHERM_REPROBE_INTERVAL  3600000
+#define OPENTHERM_TRANSPORT_PRIORITY  5
+#define OPENTHERM_READY_STATUS_COUNT  3
+#define OPENTHERM_OFFLINE_PROBE_MIN 1000
+#define OPENTHERM_OFFLINE_PROBE_MAX 60000
+#define OPENTHERM_READY_TIMEOUT     60000
+// rounds of the probe sweep for the ids without an answer
+#define OPENTHERM_PROBE_ROUNDS      3
+#define OPENTHERM_PROBE_RETRY_INTERVAL  60000
+// a value which the boiler rejected is written again after this interval or when it changes
+#define OPENTHERM_REJECTED_WRITE_INTERVAL  60000
 
 #define EXT_SENSORS_INTERVAL        5000
 #define EXT_SENSORS_FILTER_K        0.15
 
+// step of the PID and the tuner, between the steps the regulator only checks vars.actions.updateSetpoint
+#define REGULATOR_STEP_INTERVAL     10000
+#define REGULATOR_WAKE_INTERVAL     100
+
 #define CONFIG_URL                  "http://%s/"
 #define SETTINGS_VALID_VALUE        "stvalid" // only 8 chars!
+#define PROFILE_VALID_VALUE         "prvalid" // only 8 chars!
 
 #define DEFAULT_HEATING_MIN_TEMP    20
 #define DEFAULT_HEATING_MAX_TEMP    90
@@ -48,6 +65,14 @@
   #define OT_OUT_PIN_DEFAULT 0
 #endif
 
+#ifndef OT_GATEWAY_IN_PIN_DEFAULT
+  #define OT_GATEWAY_IN_PIN_DEFAULT 0
+#endif
+
+#ifndef OT_GATEWAY_OUT_PIN_DEFAULT
+  #define OT_GATEWAY_OUT_PIN_DEFAULT 0
+#endif
+
 #ifndef SENSOR_OUTDOOR_PIN_DEFAULT
   #define SENSOR_OUTDOOR_PIN_DEFAULT 0
 #endif
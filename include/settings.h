@@ -17,6 +17,17 @@ struct Settings {
     bool heatingCh1ToCh2 = false;
     bool dhwToCh2 = false;
     bool dhwBlocking = false;
+    bool adaptivePacing = false;
+    // seconds
+    unsigned int writeKeepAlive = 60;
+    // share of the bus time for raw frames from mqtt, %
+    byte rawBudget = 10;
+    // pass-through between a room thermostat and the boiler
+    bool gateway = false;
+    byte gatewayInPin = OT_GATEWAY_IN_PIN_DEFAULT;
+    byte gatewayOutPin = OT_GATEWAY_OUT_PIN_DEFAULT;
+    bool overrideTSet = true;
+    bool overrideMaxModulation = true;
   } opentherm;
 
   struct {
@@ -39,6 +50,10 @@ struct Settings {
     bool turbo = false;
     float target = 40.0f;
     float hysteresis = 0.5f;
+    // шаг квантования температуры теплоносителя
+    float setpointStep = 0.1f;
+    // температура теплоносителя меняется, только если разница не меньше
+    float setpointDeadband = 0.3f;
     byte minTemp = DEFAULT_HEATING_MIN_TEMP;
     byte maxTemp = DEFAULT_HEATING_MAX_TEMP;
     byte maxModulation = 100;
@@ -86,10 +101,33 @@ struct Settings {
   char validationValue[8] = SETTINGS_VALID_VALUE;
 };
 
+// результаты опроса котла, хранятся после настроек
+struct BoilerProfile {
+  bool probed = false;
+  // профиль действителен только для того же котла
+  uint8_t slaveMemberIdCode = 0;
+  uint8_t slaveType = 0;
+  uint8_t slaveVersion = 0;
+  uint8_t slaveFlags = 0;
+  uint32_t supported[8] = {0};
+  uint32_t unsupported[8] = {0};
+  char validationValue[8] = PROFILE_VALID_VALUE;
+};
+
 struct Variables {
   struct {
     bool enable = false;
     byte regulator = 0;
+    // equitherm tuner: 0 - idle, 1 - settling, 2 - measuring, 3 - finished
+    byte state = 0;
+    // 'n' or 'k'
+    char factor = 'n';
+    // of the current window, %
+    byte progress = 0;
+    byte steps = 0;
+    byte converged = 0;
+    // target - indoor of the last measured window
+    float error = 0;
   } tuning;
 
   struct {
@@ -121,20 +159,59 @@ struct Variables {
     bool heatingEnabled = false;
     byte heatingMinTemp = DEFAULT_HEATING_MIN_TEMP;
     byte heatingMaxTemp = DEFAULT_HEATING_MAX_TEMP;
-    byte heatingSetpoint = 0;
+    float heatingSetpoint = 0;
     byte dhwMinTemp = DEFAULT_DHW_MIN_TEMP;
     byte dhwMaxTemp = DEFAULT_DHW_MAX_TEMP;
     uint8_t slaveMemberIdCode;
+    uint8_t slaveFlags;
     uint8_t slaveType;
     uint8_t slaveVersion;
     uint8_t masterType;
     uint8_t masterVersion;
   } parameters;
 
+  struct {
+    float returnTemp = 0.0f;
+    float exhaustTemp = 0.0f;
+    uint16_t oemDiagnosticCode = 0;
+    uint16_t burnerStarts = 0;
+    uint16_t chPumpStarts = 0;
+    uint16_t dhwPumpValveStarts = 0;
+    uint16_t dhwBurnerStarts = 0;
+    uint16_t burnerHours = 0;
+    uint16_t chPumpHours = 0;
+    uint16_t dhwPumpValveHours = 0;
+    uint16_t dhwBurnerHours = 0;
+  } telemetry;
+
+  struct {
+    unsigned long missedDeadlines = 0;
+    unsigned long memberIdSavedPerHour = 0;
+    unsigned long latency = 0;
+    unsigned long frameGap = 0;
+    unsigned long skippedWrites = 0;
+    unsigned long probeTime = 0;
+    unsigned long readyTime = 0;
+    unsigned long startupTime = 0;
+    // bus time over the last minute, %
+    float busTx = 0.0f;
+    float busRx = 0.0f;
+    float busGap = 0.0f;
+    float busRetry = 0.0f;
+    unsigned long gatewayLatency = 0;
+    unsigned long gatewayOverhead = 0;
+    unsigned long gatewayMaxLatency = 0;
+  } opentherm;
+
   struct {
     bool restart = false;
     bool resetFault = false;
     bool resetDiagnostic = false;
+    bool publishStats = false;
+    // 1 - binary over mqtt, 2 - text to log
+    byte dumpTrace = 0;
+    // the inputs of the regulator changed: set by the tasks which write them, cleared by the RegulatorTask
+    volatile bool updateSetpoint = false;
   } actions;
 };
 
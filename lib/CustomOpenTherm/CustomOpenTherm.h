@@ -1,12 +1,86 @@
+#pragma once
 #include <Arduino.h>
 #include <OpenTherm.h>
+#include <atomic>
+
+// the master must wait at least 100 ms after the response before the next request
+#define OT_MIN_FRAME_GAP          100
+#define OT_CONSERVATIVE_FRAME_GAP 200
+// frames sent with the conservative gap after an error
+#define OT_PACING_ERROR_FRAMES    16
+
+#ifndef OT_WRITE_CACHE_SIZE
+  #define OT_WRITE_CACHE_SIZE     8
+#endif
 
 class CustomOpenTherm : public OpenTherm {
+public:
+  enum class RequestState : byte {
+    IDLE,
+    WAITING,
+    SENDING,
+    DONE
+  };
+
+  enum class PacingMode : byte {
+    // always OT_CONSERVATIVE_FRAME_GAP
+    FIXED,
+    // gap based on the measured slave response latency
+    ADAPTIVE,
+    // the master behind the gateway paces the frames, only OT_MIN_FRAME_GAP
+    GATEWAY
+  };
+
+  struct Request {
+    unsigned long request = 0;
+    unsigned long response = 0;
+    OpenThermResponseStatus status = OpenThermResponseStatus::NONE;
+    byte attempts = 5;
+    byte attempt = 0;
+    // ms on the bus of all attempts: from the request to the response or the timeout
+    unsigned long busTime = 0;
+    volatile RequestState state = RequestState::IDLE;
+    void(*completeCallback)(Request*, void*) = nullptr;
+    void* completeArg = nullptr;
+
+    // safe to call from another task, the result fields are visible after it returned true
+    bool isDone() {
+      if (state != RequestState::DONE) {
+        return false;
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return true;
+    }
+  };
+
 private:
   unsigned long send_ts = millis();
-  void(*handleSendRequestCallback)(unsigned long, unsigned long, OpenThermResponseStatus status, byte attempt);
-  void(*yieldCallback)(void*);
-  void* yieldArg;
+  unsigned long start_ts = 0;
+  unsigned long queued_ts = 0;
+  Request* current = nullptr;
+  PacingMode pacingMode = PacingMode::FIXED;
+  unsigned long latency = 0;
+  unsigned long lastLatency = 0;
+  unsigned long lastAttemptTime = 0;
+  unsigned long lastGap = 0;
+  byte pacingErrorFrames = 0;
+
+  // last acknowledged value per write data id
+  struct {
+    byte id;
+    unsigned int data;
+    unsigned long ts;
+    bool valid;
+  } writeCache[OT_WRITE_CACHE_SIZE] = {};
+  unsigned long writeKeepAlive = 60000;
+  #if defined(ESP32)
+    // the poll task and the transport share core 1, the higher priority transport preempts the poll task while it reads the cache
+    portMUX_TYPE writeCacheMux = portMUX_INITIALIZER_UNLOCKED;
+  #endif
+  void(*handleSendRequestCallback)(unsigned long, unsigned long, OpenThermResponseStatus status, byte attempt) = nullptr;
+  void(*yieldCallback)(void*) = nullptr;
+  void* yieldArg = nullptr;
 
 public:
   CustomOpenTherm(int inPin = 4, int outPin = 5, bool isSlave = false) : OpenTherm(inPin, outPin, isSlave) {}
@@ -24,46 +98,202 @@ public:
     this->yieldArg = arg;
   }
 
-  unsigned long sendRequest(unsigned long request, byte attempts = 5, byte _attempt = 0) {
-    _attempt++;
-    while (send_ts > 0 && millis() - send_ts < 200) {
-      if (yieldCallback != NULL) {
-        yieldCallback(yieldArg);
+  void setPacingMode(PacingMode mode) {
+    this->pacingMode = mode;
+  }
 
-      } else {
-        ::yield();
-      }
+  PacingMode getPacingMode() {
+    return pacingMode;
+  }
+
+  // smoothed time from the start of the request to the response, ms
+  unsigned long getLatency() {
+    return latency;
+  }
+
+  // time from the start of the last attempt to the response, ms
+  unsigned long getLastLatency() {
+    return lastLatency;
+  }
+
+  // time from the start of the last attempt to the response or the timeout, ms
+  unsigned long getLastAttemptTime() {
+    return lastAttemptTime;
+  }
+
+  // time the last attempt waited for the frame gap after the request was queued, ms
+  unsigned long getLastGap() {
+    return lastGap;
+  }
+
+  unsigned long getFrameGap() {
+    if (pacingMode == PacingMode::GATEWAY) {
+      return OT_MIN_FRAME_GAP;
     }
 
-    unsigned long _response;
-    if (!sendRequestAync(request)) {
-      _response = 0;
-    } else {
-      while (!isReady()) {
-        if (yieldCallback != NULL) {
-          yieldCallback(yieldArg);
+    if (pacingMode == PacingMode::FIXED || pacingErrorFrames > 0 || latency == 0) {
+      return OT_CONSERVATIVE_FRAME_GAP;
+    }
 
-        } else {
-          ::yield();
-        }
+    // slow slaves get a bit more time to settle
+    return constrain(latency / 2, OT_MIN_FRAME_GAP, OT_CONSERVATIVE_FRAME_GAP);
+  }
+
+  void setWriteKeepAlive(unsigned long value) {
+    this->writeKeepAlive = value;
+  }
+
+  // false if the same value was acknowledged by the slave less than keep-alive ago
+  bool needWrite(unsigned long request) {
+    if (((request >> 28) & 0x7) != (byte) OpenThermMessageType::WRITE_DATA) {
+      return true;
+    }
+
+    unsigned long now = millis();
+    bool result = true;
+
+    lockWriteCache();
+    int index = findWriteCacheItem((request >> 16) & 0xFF);
+    if (index >= 0 && writeCache[index].valid && writeCache[index].data == (request & 0xFFFF)) {
+      result = now - writeCache[index].ts >= writeKeepAlive;
+    }
+    unlockWriteCache();
+
+    return result;
+  }
+
+  void resetWriteCache() {
+    lockWriteCache();
+    for (byte i = 0; i < OT_WRITE_CACHE_SIZE; i++) {
+      writeCache[i].valid = false;
+    }
+    unlockWriteCache();
+  }
+
+  bool isBusy() {
+    return current != nullptr;
+  }
+
+  // Queues the request, the result is available after request.isDone() or in completeCallback.
+  // Only one request can be on the wire, returns false if the bus is busy.
+  bool sendRequestAsync(Request& request) {
+    if (current != nullptr) {
+      return false;
+    }
+
+    request.response = 0;
+    request.status = OpenThermResponseStatus::NONE;
+    request.attempt = 0;
+    request.busTime = 0;
+    request.state = RequestState::WAITING;
+    current = &request;
+    queued_ts = millis();
+
+    return true;
+  }
+
+  // Advances the current request, must be called as often as possible
+  void tick() {
+    if (current == nullptr) {
+      process();
+      return;
+    }
+
+    if (current->state == RequestState::WAITING) {
+      if (send_ts > 0 && millis() - send_ts < getFrameGap()) {
+        return;
+      }
 
+      // the library keeps its own delay after the response
+      if (!isReady()) {
         process();
+        return;
       }
 
-      _response = getLastResponse();
+      current->attempt++;
+
+      // the gap counts from the later of the queueing and the previous frame
+      unsigned long ready_ts = millis() - queued_ts < millis() - send_ts ? queued_ts : send_ts;
+      lastGap = millis() - ready_ts;
+
+      if (sendRequestAync(current->request)) {
+        current->state = RequestState::SENDING;
+        start_ts = millis();
+        return;
+      }
+
+      start_ts = millis();
+      completeAttempt(0);
+
+    } else if (current->state == RequestState::SENDING) {
+      process();
+
+      // done as soon as the response is received, not after the delay which follows it
+      if (status == OpenThermStatus::DELAY || isReady()) {
+        completeAttempt(getLastResponse());
+      }
     }
+  }
 
-    OpenThermResponseStatus _responseStatus = getLastResponseStatus();
-    if (handleSendRequestCallback != NULL) {
-      handleSendRequestCallback(request, _response, _responseStatus, _attempt);
+  unsigned long sendRequest(unsigned long request, byte attempts = 5) {
+    Request _request;
+    _request.request = request;
+    _request.attempts = attempts;
+
+    while (!sendRequestAsync(_request)) {
+      doYield();
+      tick();
     }
 
-    send_ts = millis();
-    if (_responseStatus == OpenThermResponseStatus::SUCCESS || _responseStatus == OpenThermResponseStatus::INVALID || _attempt >= attempts) {
-      return _response;
-    } else {
-      return sendRequest(request, attempts, _attempt);
+    while (!_request.isDone()) {
+      tick();
+
+      if (!_request.isDone()) {
+        doYield();
+      }
     }
+
+    return _request.response;
+  }
+
+  // The library counts the bits one by one. The frame is xor-folded to a nibble instead,
+  // its parity is the bit of the 16 bit table 0x6996.
+  static bool parity(unsigned long frame) {
+    frame ^= frame >> 16;
+    frame ^= frame >> 8;
+    frame ^= frame >> 4;
+
+    return (0x6996 >> (frame & 0x0F)) & 1;
+  }
+
+  static unsigned long buildRequest(OpenThermMessageType type, OpenThermMessageID id, unsigned int data) {
+    unsigned long frame = (((unsigned long) type & 0x7) << 28) | ((unsigned long) id << 16) | (data & 0xFFFF);
+    return frame | ((unsigned long) parity(frame) << 31);
+  }
+
+  static unsigned long buildResponse(OpenThermMessageType type, OpenThermMessageID id, unsigned int data) {
+    return buildRequest(type, id, data);
+  }
+
+  // f8.8, rounded to the nearest 1/256 instead of truncated: 45.3 is sent as 45.30, not 45.29
+  static unsigned int temperatureToData(float temperature) {
+    temperature = constrain(temperature, 0, 100);
+    return (unsigned int) (temperature * 256 + 0.5f);
+  }
+
+  // READ_ACK or WRITE_ACK with the valid parity
+  static bool isValidResponse(unsigned long response) {
+    return ((((response >> 28) & 0x6) ^ 0x4) | parity(response)) == 0;
+  }
+
+  // the response to this very request: READ_DATA -> READ_ACK, WRITE_DATA -> WRITE_ACK, the same data id, valid parity
+  static bool isValidResponse(unsigned long request, unsigned long response) {
+    unsigned long mismatch = ((response >> 28) & 0x6) ^ 0x4;
+    // bit 28 of the type (write) and the data id
+    mismatch |= ((request ^ response) >> 16) & 0x10FF;
+    mismatch |= parity(response);
+
+    return mismatch == 0;
   }
 
   unsigned long setBoilerStatus(bool enableCentralHeating, bool enableHotWater, bool enableCooling, bool enableOutsideTemperatureCompensation, bool enableCentralHeating2, bool summerWinterMode, bool dhwBlocking) {
@@ -78,43 +308,166 @@ public:
 
   bool setHeatingCh1Temp(float temperature) {
     unsigned int data = temperatureToData(temperature);
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, data));
-    return isValidResponse(response);
+    unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, data);
+    return isValidResponse(request, sendRequest(request));
   }
 
   bool setHeatingCh2Temp(float temperature) {
     unsigned int data = temperatureToData(temperature);
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TsetCH2, data));
-    return isValidResponse(response);
+    unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TsetCH2, data);
+    return isValidResponse(request, sendRequest(request));
   }
 
   bool setDhwTemp(float temperature) {
     unsigned int data = temperatureToData(temperature);
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TdhwSet, data));
-    return isValidResponse(response);
+    unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TdhwSet, data);
+    return isValidResponse(request, sendRequest(request));
   }
 
   bool sendBoilerReset() {
     unsigned int data = 1;
     data <<= 8;
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, data));
-    return isValidResponse(response);
+    unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, data);
+    return isValidResponse(request, sendRequest(request));
   }
 
   bool sendServiceReset() {
     unsigned int data = 10;
     data <<= 8;
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, data));
-    return isValidResponse(response);
+    unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, data);
+    return isValidResponse(request, sendRequest(request));
   }
 
   bool sendWaterFilling() {
     unsigned int data = 2;
     data <<= 8;
-    unsigned long response = sendRequest(buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, data));
-    return isValidResponse(response);
+    unsigned long request = buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, data);
+    return isValidResponse(request, sendRequest(request));
+  }
+
+protected:
+  void doYield() {
+    if (yieldCallback != NULL) {
+      yieldCallback(yieldArg);
+
+    } else {
+      ::yield();
+    }
+  }
+
+  void completeAttempt(unsigned long response) {
+    Request* request = current;
+    request->response = response;
+    request->status = getLastResponseStatus();
+    lastAttemptTime = millis() - start_ts;
+    request->busTime += lastAttemptTime;
+
+    // the library does not check that the slave answered this data id
+    if (request->status == OpenThermResponseStatus::SUCCESS && !isValidResponse(request->request, response)) {
+      request->status = OpenThermResponseStatus::INVALID;
+    }
+
+    if (request->status == OpenThermResponseStatus::SUCCESS) {
+      lastLatency = millis() - start_ts;
+      latency = latency == 0 ? lastLatency : latency + ((long) lastLatency - (long) latency) / 8;
+
+      if (pacingErrorFrames > 0) {
+        pacingErrorFrames--;
+      }
+
+    } else {
+      lastLatency = 0;
+      pacingErrorFrames = OT_PACING_ERROR_FRAMES;
+    }
+
+    if (handleSendRequestCallback != NULL) {
+      handleSendRequestCallback(request->request, request->response, request->status, request->attempt);
+    }
+
+    updateWriteCache(request->request, request->status == OpenThermResponseStatus::SUCCESS);
+
+    send_ts = millis();
+    if (request->status == OpenThermResponseStatus::SUCCESS || request->status == OpenThermResponseStatus::INVALID || request->attempt >= request->attempts) {
+      current = nullptr;
+
+      // the owner may reuse or release the request as soon as it sees DONE: the callback goes first
+      if (request->completeCallback != nullptr) {
+        request->completeCallback(request, request->completeArg);
+      }
+
+      std::atomic_thread_fence(std::memory_order_release);
+      request->state = RequestState::DONE;
+
+    } else {
+      request->state = RequestState::WAITING;
+    }
+  }
+
+  void lockWriteCache() {
+    #if defined(ESP32)
+      portENTER_CRITICAL(&writeCacheMux);
+    #endif
   }
 
+  void unlockWriteCache() {
+    #if defined(ESP32)
+      portEXIT_CRITICAL(&writeCacheMux);
+    #endif
+  }
+
+  int findWriteCacheItem(byte id) {
+    for (byte i = 0; i < OT_WRITE_CACHE_SIZE; i++) {
+      if (writeCache[i].ts > 0 && writeCache[i].id == id) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  void updateWriteCache(unsigned long request, bool acknowledged) {
+    if (((request >> 28) & 0x7) != (byte) OpenThermMessageType::WRITE_DATA) {
+      return;
+    }
+
+    byte id = (request >> 16) & 0xFF;
+    unsigned long now = max(millis(), 1UL);
+
+    lockWriteCache();
+    int index = findWriteCacheItem(id);
+
+    if (!acknowledged) {
+      if (index >= 0) {
+        writeCache[index].valid = false;
+      }
+
+      unlockWriteCache();
+      return;
+    }
+
+    if (index < 0) {
+      // free slot or the oldest one
+      index = 0;
+      for (byte i = 0; i < OT_WRITE_CACHE_SIZE; i++) {
+        if (writeCache[i].ts == 0) {
+          index = i;
+          break;
+        }
+
+        if (writeCache[i].ts < writeCache[index].ts) {
+          index = i;
+        }
+      }
+    }
+
+    writeCache[index].id = id;
+    writeCache[index].data = request & 0xFFFF;
+    writeCache[index].ts = now;
+    writeCache[index].valid = true;
+    unlockWriteCache();
+  }
+
+public:
   // converters
   float f88(unsigned long response) {
     const byte valueLB = response & 0xFF;
@@ -1,26 +1,28 @@
+#pragma once
 #include <Arduino.h>
+#include "FixedPoint.h"
 
-#if defined(EQUITHERM_INTEGER)
-// расчёты с целыми числами
-typedef int datatype;
-#else
-// расчёты с float числами
-typedef float datatype;
-#endif
+// кривая Kn хранится таблицей: температура подачи через 0.5° наружной температуры от -40 до +30
+#define EQUITHERM_TABLE_MIN   -40
+#define EQUITHERM_TABLE_MAX   30
+#define EQUITHERM_TABLE_STEPS 2
+#define EQUITHERM_TABLE_SIZE  ((EQUITHERM_TABLE_MAX - EQUITHERM_TABLE_MIN) * EQUITHERM_TABLE_STEPS + 1)
 
-class Equitherm {
+// T - float или FixedPoint (расчёты без FPU)
+template <class T>
+class EquithermT {
 public:
-  datatype targetTemp = 0;
-  datatype indoorTemp = 0;
-  datatype outdoorTemp = 0;
-  float Kn = 0.0;
-  float Kk = 0.0;
-  float Kt = 0.0;
+  T targetTemp = 0;
+  T indoorTemp = 0;
+  T outdoorTemp = 0;
+  T Kn = 0;
+  T Kk = 0;
+  T Kt = 0;
 
-  Equitherm() {}
+  EquithermT() {}
 
   // kn, kk, kt
-  Equitherm(float new_kn, float new_kk, float new_kt) {
+  EquithermT(T new_kn, T new_kk, T new_kt) {
     Kn = new_kn;
     Kk = new_kk;
     Kt = new_kt;
@@ -33,31 +35,87 @@ public:
   }
 
   // возвращает новое значение при вызове
-  datatype getResult() {
-    datatype output = getResultN() + getResultK() + getResultT();
-    output = constrain(output, _minOut, _maxOut);		// ограничиваем выход
+  T getResult() {
+    T output = getResultN() + getResultK() + getResultT();
+    output = clamp(output, _minOut, _maxOut);		// ограничиваем выход
     return output;
   }
 
+  // температура подачи по кривой Kn без поправок, линейная интерполяция по таблице
+  // за пределами таблицы - крайние значения
+  T getCurve(T outdoor) {
+    if (!_tableValid || _tableKn != Kn) {
+      buildTable();
+    }
+
+    T position = (clamp(outdoor, T(EQUITHERM_TABLE_MIN), T(EQUITHERM_TABLE_MAX)) - T(EQUITHERM_TABLE_MIN)) * T(EQUITHERM_TABLE_STEPS);
+    int index = (int) position;
+    if (index >= EQUITHERM_TABLE_SIZE - 1) {
+      return _table[EQUITHERM_TABLE_SIZE - 1];
+    }
+
+    return _table[index] + (_table[index + 1] - _table[index]) * (position - T(index));
+  }
+
+  // таблица кривой Kn (EQUITHERM_TABLE_SIZE значений от EQUITHERM_TABLE_MIN), nullptr пока не построена
+  const T* getTable() const {
+    return _tableValid ? _table : nullptr;
+  }
+
+  // Kn, по которому построена таблица
+  T getTableKn() const {
+    return _tableKn;
+  }
+
+  // кривая Kn по формуле, без таблицы
+  static float calcCurve(float kn, float outdoor) {
+    float a = (-0.21f * kn) - 0.06f;      // a = -0,21k — 0,06
+    float b = (6.04f * kn) + 1.98f;       // b = 6,04k + 1,98
+    float c = (-5.06f * kn) + 18.06f;     // с = -5,06k + 18,06
+    float x = (-0.2f * outdoor) + 5;      // x = -0.2*t1 + 5
+    return (a * x * x) + (b * x) + c;     // Tn = ax2 + bx + c
+  }
+
 private:
-  int _minOut = 20, _maxOut = 90;
+  T _minOut = 20, _maxOut = 90;
+  T _table[EQUITHERM_TABLE_SIZE];
+  T _tableKn = 0;
+  bool _tableValid = false;
+
+  // таблица пересчитывается только при изменении Kn, сама кривая считается во float
+  void buildTable() {
+    for (int i = 0; i < EQUITHERM_TABLE_SIZE; i++) {
+      _table[i] = T(calcCurve((float) Kn, EQUITHERM_TABLE_MIN + (float) i / EQUITHERM_TABLE_STEPS));
+    }
+
+    _tableKn = Kn;
+    _tableValid = true;
+  }
+
+  static T clamp(T value, T low, T high) {
+    return value < low ? low : (value > high ? high : value);
+  }
 
   // температура контура отопления в зависимости от наружной температуры
-  datatype getResultN() {
-    float a = (-0.21 * Kn) - 0.06;     // a = -0,21k — 0,06
-    float b = (6.04 * Kn) + 1.98;      // b = 6,04k + 1,98
-    float c = (-5.06 * Kn) + 18.06;    // с = -5,06k + 18,06
-    float x = (-0.2 * outdoorTemp) + 5; // x = -0.2*t1 + 5
-    return (a * x * x) + (b * x) + c;       // Tn = ax2 + bx + c
+  T getResultN() {
+    return getCurve(outdoorTemp);
   }
 
   // поправка на желаемую комнатную температуру
-  datatype getResultK() {
-    return (targetTemp - 20) * Kk;
+  T getResultK() {
+    return (targetTemp - T(20)) * Kk;
   }
 
   // Расчет поправки (ошибки) термостата
-  datatype getResultT() {
-    return constrain((targetTemp - indoorTemp), -2, 2) * Kt;
+  T getResultT() {
+    return clamp(targetTemp - indoorTemp, T(-2), T(2)) * Kt;
   }
-};
\ No newline at end of file
+};
+
+#if defined(EQUITHERM_FIXED)
+// расчёты с фиксированной точкой Q16.16
+typedef EquithermT<fixed16_t> Equitherm;
+#else
+// расчёты с float числами
+typedef EquithermT<float> Equitherm;
+#endif
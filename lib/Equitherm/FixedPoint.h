@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <type_traits>
+
+// число с фиксированной точкой: FRACTION бит дробной части в int32_t, FixedPoint<16> = Q16.16
+// float используется только при преобразованиях, арифметика целочисленная
+template <byte FRACTION>
+class FixedPoint {
+public:
+  static constexpr int32_t ONE = (int32_t) 1 << FRACTION;
+  int32_t raw = 0;
+
+  constexpr FixedPoint() {}
+  // любой целый тип: round() ядра ESP8266 возвращает long, с отдельными int/float/double вызов был бы неоднозначным
+  template <class I, typename std::enable_if<std::is_integral<I>::value, int>::type = 0>
+  constexpr FixedPoint(I value) : raw((int32_t) value * ONE) {}
+  FixedPoint(float value) : raw((int32_t) (value * ONE + (value < 0 ? -0.5f : 0.5f))) {}
+  FixedPoint(double value) : FixedPoint((float) value) {}
+
+  static FixedPoint fromRaw(int32_t value) {
+    FixedPoint result;
+    result.raw = value;
+    return result;
+  }
+
+  explicit operator float() const {
+    return (float) raw / ONE;
+  }
+
+  // с отбрасыванием дробной части, как у float
+  explicit operator int() const {
+    return raw / ONE;
+  }
+
+  FixedPoint operator-() const {
+    return fromRaw(-raw);
+  }
+
+  FixedPoint operator+(const FixedPoint& other) const {
+    return fromRaw(raw + other.raw);
+  }
+
+  FixedPoint operator-(const FixedPoint& other) const {
+    return fromRaw(raw - other.raw);
+  }
+
+  // произведение в 64 битах с округлением
+  FixedPoint operator*(const FixedPoint& other) const {
+    return fromRaw((int32_t) (((int64_t) raw * other.raw + (ONE >> 1)) >> FRACTION));
+  }
+
+  FixedPoint operator/(const FixedPoint& other) const {
+    return fromRaw((int32_t) (((int64_t) raw * ONE) / other.raw));
+  }
+
+  FixedPoint& operator+=(const FixedPoint& other) {
+    raw += other.raw;
+    return *this;
+  }
+
+  FixedPoint& operator-=(const FixedPoint& other) {
+    raw -= other.raw;
+    return *this;
+  }
+
+  bool operator==(const FixedPoint& other) const { return raw == other.raw; }
+  bool operator!=(const FixedPoint& other) const { return raw != other.raw; }
+  bool operator<(const FixedPoint& other) const { return raw < other.raw; }
+  bool operator>(const FixedPoint& other) const { return raw > other.raw; }
+  bool operator<=(const FixedPoint& other) const { return raw <= other.raw; }
+  bool operator>=(const FixedPoint& other) const { return raw >= other.raw; }
+};
+
+typedef FixedPoint<16> fixed16_t;
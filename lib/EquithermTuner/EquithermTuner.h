@@ -0,0 +1,210 @@
+#pragma once
+#include <Arduino.h>
+#include <Equitherm.h>
+
+// length of the window the indoor temperature is averaged over, ms
+#ifndef EQUITHERM_TUNER_WINDOW
+  #define EQUITHERM_TUNER_WINDOW 1800000
+#endif
+
+// flow temperature needed for 1 degree of the indoor temperature
+#ifndef EQUITHERM_TUNER_FLOW_GAIN
+  #define EQUITHERM_TUNER_FLOW_GAIN 2.0f
+#endif
+
+// the window is steady while the outdoor temperature stays within this span and the indoor one drifts less
+#define EQUITHERM_TUNER_OUTDOOR_SPAN  2.0f
+#define EQUITHERM_TUNER_INDOOR_DRIFT  0.3f
+// N is fitted at the targets of 20 +- this band, K at the others
+#define EQUITHERM_TUNER_N_BAND        1.0f
+#define EQUITHERM_TUNER_MAX_STEPS     40
+
+// Online fitting of the equitherm factors N and K, the same steps as the manual fitting:
+// at the target of about 20 degrees the curve (N), at the other targets the correction (K).
+// The indoor temperature is averaged over steady windows, after every window with an error
+// the factor is moved towards zero error by a bounded step. The window after a step is skipped,
+// the house needs it to settle.
+class EquithermTuner {
+public:
+  enum State : byte {
+    IDLE = 0,
+    // waiting for a steady window or the house settles after a step
+    SETTLING = 1,
+    MEASURING = 2,
+    FINISHED = 3
+  };
+
+  // error within the tolerance for converge windows in a row finishes the tuning
+  void setParameters(float tolerance = 0.2f, byte converge = 2, float maxStepN = 0.1f, float maxStepK = 0.5f) {
+    _tolerance = tolerance;
+    _converge = converge;
+    _maxStepN = maxStepN;
+    _maxStepK = maxStepK;
+  }
+
+  void start(float kn, float kk, unsigned long now) {
+    _kn = kn;
+    _kk = kk;
+    _state = SETTLING;
+    _steps = 0;
+    _converged = 0;
+    _error = 0;
+    _tuningN = true;
+    restart(now);
+  }
+
+  void reset() {
+    _state = IDLE;
+  }
+
+  // must be called periodically with the current values, returns true if the factors changed
+  bool update(float indoor, float outdoor, float target, unsigned long now) {
+    if (_state == IDLE || _state == FINISHED) {
+      return false;
+    }
+
+    // the target changed or the weather turned: start over
+    bool restarted = _count > 0 && (target != _target
+      || max(_outdoorMax, outdoor) - min(_outdoorMin, outdoor) > EQUITHERM_TUNER_OUTDOOR_SPAN);
+
+    if (restarted) {
+      _state = SETTLING;
+    }
+
+    if (_count == 0 || restarted) {
+      restart(now);
+      _target = target;
+      _tuningN = fabs(target - 20) < EQUITHERM_TUNER_N_BAND;
+      _indoorFirst = indoor;
+      _outdoorMin = _outdoorMax = outdoor;
+    }
+
+    _indoorSum += indoor;
+    _outdoorSum += outdoor;
+    _indoorLast = indoor;
+    _outdoorMin = min(_outdoorMin, outdoor);
+    _outdoorMax = max(_outdoorMax, outdoor);
+    _count++;
+
+    if (now - _windowStart < EQUITHERM_TUNER_WINDOW) {
+      return false;
+    }
+
+    float indoorAvg = _indoorSum / _count;
+    float outdoorAvg = _outdoorSum / _count;
+    bool steady = fabs(_indoorLast - _indoorFirst) < EQUITHERM_TUNER_INDOOR_DRIFT;
+    bool settled = _state == MEASURING;
+
+    restart(now);
+    if (!steady || !settled) {
+      _state = steady ? MEASURING : SETTLING;
+      return false;
+    }
+
+    _error = target - indoorAvg;
+
+    if (fabs(_error) <= _tolerance) {
+      if (++_converged >= _converge) {
+        _state = FINISHED;
+      }
+
+      return false;
+    }
+
+    _converged = 0;
+    if (_steps >= EQUITHERM_TUNER_MAX_STEPS) {
+      _state = FINISHED;
+      return false;
+    }
+
+    // flow temperature that would remove the error
+    float flow = _error * EQUITHERM_TUNER_FLOW_GAIN;
+
+    if (_tuningN) {
+      // the curve rises faster at low outdoor temperatures: the step of N depends on the slope here
+      float slope = (EquithermT<float>::calcCurve(_kn + 0.1f, outdoorAvg) - EquithermT<float>::calcCurve(_kn, outdoorAvg)) / 0.1f;
+      _kn = constrain(_kn + constrain(flow / max(slope, 1.0f), -_maxStepN, _maxStepN), 0.001f, 10.0f);
+
+    } else {
+      _kk = constrain(_kk + constrain(flow / (target - 20), -_maxStepK, _maxStepK), 0.0f, 10.0f);
+    }
+
+    _steps++;
+    _state = SETTLING;
+    return true;
+  }
+
+  State getState() {
+    return _state;
+  }
+
+  bool isConverged() {
+    return _state == FINISHED && _converged >= _converge;
+  }
+
+  // the factor fitted now: 'n' or 'k'
+  char getFactor() {
+    return _tuningN ? 'n' : 'k';
+  }
+
+  float getKn() {
+    return _kn;
+  }
+
+  float getKk() {
+    return _kk;
+  }
+
+  // target - indoor of the last measured window
+  float getError() {
+    return _error;
+  }
+
+  byte getSteps() {
+    return _steps;
+  }
+
+  byte getConverged() {
+    return _converged;
+  }
+
+  // share of the current window, %
+  byte getProgress(unsigned long now) {
+    if (_state != SETTLING && _state != MEASURING) {
+      return _state == FINISHED ? 100 : 0;
+    }
+
+    return min((now - _windowStart) * 100 / EQUITHERM_TUNER_WINDOW, 100UL);
+  }
+
+protected:
+  State _state = IDLE;
+  float _tolerance = 0.2f;
+  byte _converge = 2;
+  float _maxStepN = 0.1f;
+  float _maxStepK = 0.5f;
+
+  float _kn = 0;
+  float _kk = 0;
+  float _error = 0;
+  bool _tuningN = true;
+  byte _steps = 0;
+  byte _converged = 0;
+
+  unsigned long _windowStart = 0;
+  float _target = 0;
+  float _indoorSum = 0;
+  float _outdoorSum = 0;
+  float _indoorFirst = 0;
+  float _indoorLast = 0;
+  float _outdoorMin = 0;
+  float _outdoorMax = 0;
+  unsigned int _count = 0;
+
+  void restart(unsigned long now) {
+    _windowStart = now;
+    _indoorSum = 0;
+    _outdoorSum = 0;
+    _count = 0;
+  }
+};
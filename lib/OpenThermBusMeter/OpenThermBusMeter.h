@@ -0,0 +1,104 @@
+#pragma once
+#include <Arduino.h>
+
+// one frame on the wire: start bit, 32 bits, stop bit, 1 ms each
+#define OT_FRAME_TIME 34
+
+#ifndef OT_BUS_METER_SECONDS
+  #define OT_BUS_METER_SECONDS 60
+#endif
+
+// Time the bus spends in frames, pacing gaps and retries, per second and over the last minute.
+class OpenThermBusMeter {
+public:
+  // ms per second
+  struct Usage {
+    // request frame of the master
+    uint16_t tx;
+    // waiting for the slave, its response frame or the timeout
+    uint16_t rx;
+    // pacing gap before the request
+    uint16_t gap;
+    // repeated attempts including their gap
+    uint16_t retry;
+  };
+
+  // must be called for every completed attempt
+  // duration - from the start of the request to the response or the timeout, gap - pacing wait before the request
+  void handleAttempt(unsigned long duration, unsigned long gap, bool retry, unsigned long now) {
+    update(now);
+
+    if (retry) {
+      add(current.retry, duration + gap);
+      return;
+    }
+
+    unsigned long tx = min(duration, (unsigned long) OT_FRAME_TIME);
+    add(current.tx, tx);
+    add(current.rx, duration - tx);
+    add(current.gap, gap);
+  }
+
+  // closes the passed seconds, returns true if at least one was closed
+  bool update(unsigned long now) {
+    if (now - secondStart < 1000) {
+      return false;
+    }
+
+    // idle for longer than the history: nothing to keep
+    if (now - secondStart >= OT_BUS_METER_SECONDS * 1000UL) {
+      memset(history, 0, sizeof(history));
+      memset(&current, 0, sizeof(current));
+      filled = OT_BUS_METER_SECONDS;
+      secondStart = now;
+      return true;
+    }
+
+    while (now - secondStart >= 1000) {
+      history[index] = current;
+      index = (index + 1) % OT_BUS_METER_SECONDS;
+      if (filled < OT_BUS_METER_SECONDS) {
+        filled++;
+      }
+
+      memset(&current, 0, sizeof(current));
+      secondStart += 1000;
+    }
+
+    return true;
+  }
+
+  // the last closed second
+  const Usage& getLast() {
+    return history[(index + OT_BUS_METER_SECONDS - 1) % OT_BUS_METER_SECONDS];
+  }
+
+  // average over the closed seconds of the last minute, % of the time
+  void getAverage(float& tx, float& rx, float& gap, float& retry) {
+    unsigned long sum[4] = {0};
+
+    for (byte i = 0; i < filled; i++) {
+      sum[0] += history[i].tx;
+      sum[1] += history[i].rx;
+      sum[2] += history[i].gap;
+      sum[3] += history[i].retry;
+    }
+
+    float scale = filled > 0 ? 100.0f / (filled * 1000.0f) : 0;
+    tx = sum[0] * scale;
+    rx = sum[1] * scale;
+    gap = sum[2] * scale;
+    retry = sum[3] * scale;
+  }
+
+protected:
+  Usage history[OT_BUS_METER_SECONDS] = {};
+  Usage current = {};
+  byte index = 0;
+  byte filled = 0;
+  unsigned long secondStart = 0;
+
+  static void add(uint16_t& value, unsigned long ms) {
+    value = min((unsigned long) value + ms, 65535UL);
+  }
+};
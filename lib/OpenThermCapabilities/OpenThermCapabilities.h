@@ -0,0 +1,143 @@
+#pragma once
+#include <Arduino.h>
+#include <OpenTherm.h>
+
+class OpenThermCapabilities {
+public:
+  // consecutive DATA_INVALID/TIMEOUT answers after which the id is considered unsupported
+  void setTreshold(byte value) {
+    treshold = value;
+  }
+
+  // how often the unsupported ids get one more chance, ms
+  void setReprobeInterval(unsigned long value) {
+    reprobeInterval = value;
+  }
+
+  // must be called for every completed request while the link is online
+  void handleResponse(unsigned long request, unsigned long response, OpenThermResponseStatus status) {
+    byte id = (request >> 16) & 0xFF;
+
+    if (status == OpenThermResponseStatus::SUCCESS) {
+      failures[id] = 0;
+
+      if (!getBit(supported, id) || getBit(unsupported, id)) {
+        setBit(supported, id, true);
+        setBit(unsupported, id, false);
+        version++;
+      }
+
+      return;
+    }
+
+    bool unknown = status == OpenThermResponseStatus::INVALID && (OpenThermMessageType) ((response >> 28) & 0x7) == OpenThermMessageType::UNKNOWN_DATA_ID;
+    if (!unknown && failures[id] < 255) {
+      failures[id]++;
+    }
+
+    if ((unknown || failures[id] >= treshold) && !getBit(unsupported, id)) {
+      setBit(unsupported, id, true);
+      setBit(supported, id, false);
+      version++;
+    }
+  }
+
+  // definite answer, e.g. of the probe sweep
+  void set(OpenThermMessageID id, bool value) {
+    byte _id = (byte) id;
+    failures[_id] = 0;
+
+    if (getBit(supported, _id) != value || getBit(unsupported, _id) == value) {
+      setBit(supported, _id, value);
+      setBit(unsupported, _id, !value);
+      version++;
+    }
+  }
+
+  // restore the bitmaps saved earlier for the same slave
+  void load(const uint32_t* _supported, const uint32_t* _unsupported) {
+    memcpy(supported, _supported, sizeof(supported));
+    memcpy(unsupported, _unsupported, sizeof(unsupported));
+    memset(reprobe, 0, sizeof(reprobe));
+    resetFailures();
+    lastReprobe = millis();
+    version++;
+  }
+
+  // false if the id is unsupported and it is not the time to re-probe it
+  bool isPollable(OpenThermMessageID id) {
+    byte _id = (byte) id;
+    if (!getBit(unsupported, _id)) {
+      return true;
+    }
+
+    if (millis() - lastReprobe > reprobeInterval) {
+      memcpy(reprobe, unsupported, sizeof(reprobe));
+      lastReprobe = millis();
+    }
+
+    if (getBit(reprobe, _id)) {
+      setBit(reprobe, _id, false);
+      return true;
+    }
+
+    return false;
+  }
+
+  bool isSupported(OpenThermMessageID id) {
+    return getBit(supported, (byte) id);
+  }
+
+  bool isUnsupported(OpenThermMessageID id) {
+    return getBit(unsupported, (byte) id);
+  }
+
+  // failure counters of the previous link session are not relevant
+  void resetFailures() {
+    memset(failures, 0, sizeof(failures));
+  }
+
+  void reset() {
+    resetFailures();
+    memset(supported, 0, sizeof(supported));
+    memset(unsupported, 0, sizeof(unsupported));
+    memset(reprobe, 0, sizeof(reprobe));
+    version++;
+  }
+
+  // changes every time the bitmaps change
+  unsigned int getVersion() {
+    return version;
+  }
+
+  const uint32_t* getSupported() {
+    return supported;
+  }
+
+  const uint32_t* getUnsupported() {
+    return unsupported;
+  }
+
+  static bool getBit(const uint32_t* bitmap, byte id) {
+    return bitmap[id >> 5] & (1UL << (id & 31));
+  }
+
+protected:
+  uint32_t supported[8] = {0};
+  uint32_t unsupported[8] = {0};
+  uint32_t reprobe[8] = {0};
+  byte failures[256] = {0};
+  byte treshold = 3;
+  unsigned long reprobeInterval = 3600000;
+  unsigned long lastReprobe = 0;
+  unsigned int version = 0;
+
+  static void setBit(uint32_t* bitmap, byte id, bool value) {
+    if (value) {
+      bitmap[id >> 5] |= 1UL << (id & 31);
+
+    } else {
+      bitmap[id >> 5] &= ~(1UL << (id & 31));
+    }
+  }
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <Arduino.h>
+#include <OpenTherm.h>
+
+enum class OpenThermDataType : byte {
+  // signed fixed point, 1/256
+  F88,
+  S16,
+  U16,
+  // two independent bytes
+  U8U8,
+  // upper/lower bound pair, only accepted if upper > lower
+  U8U8_BOUNDS,
+  // flags in the high byte, code in the low byte
+  FLAG8
+};
+
+struct OpenThermDataField {
+  OpenThermMessageID id;
+  OpenThermDataType type;
+
+  // F88, S16: value * scale + *offset
+  float* value;
+  float scale;
+  const float* offset;
+
+  // U16, counters and codes
+  uint16_t* word;
+
+  // U8U8, U8U8_BOUNDS, FLAG8
+  byte* hb;
+  byte* lb;
+};
+
+class OpenThermDecoder {
+public:
+  static constexpr OpenThermDataField number(OpenThermMessageID id, OpenThermDataType type, float* value, float scale = 1, const float* offset = nullptr) {
+    return {id, type, value, scale, offset, nullptr, nullptr, nullptr};
+  }
+
+  static constexpr OpenThermDataField word(OpenThermMessageID id, uint16_t* value) {
+    return {id, OpenThermDataType::U16, nullptr, 1, nullptr, value, nullptr, nullptr};
+  }
+
+  static constexpr OpenThermDataField bytes(OpenThermMessageID id, OpenThermDataType type, byte* hb, byte* lb) {
+    return {id, type, nullptr, 1, nullptr, nullptr, hb, lb};
+  }
+
+  template <size_t N>
+  static const OpenThermDataField* find(const OpenThermDataField (&fields)[N], OpenThermMessageID id) {
+    for (size_t i = 0; i < N; i++) {
+      if (fields[i].id == id) {
+        return &fields[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  // response must be already validated, false if the value is out of range
+  static bool decode(const OpenThermDataField& field, unsigned long response) {
+    uint16_t data = response & 0xFFFF;
+    float value;
+
+    switch (field.type) {
+    case OpenThermDataType::F88:
+      value = (int16_t) data / 256.0f;
+      break;
+
+    case OpenThermDataType::S16:
+      value = (int16_t) data;
+      break;
+
+    case OpenThermDataType::U16:
+      *field.word = data;
+      return true;
+
+    case OpenThermDataType::U8U8_BOUNDS:
+      if ((data >> 8) <= (data & 0xFF)) {
+        return false;
+      }
+      // fall through
+
+    default:
+      if (field.hb != nullptr) {
+        *field.hb = data >> 8;
+      }
+
+      if (field.lb != nullptr) {
+        *field.lb = data & 0xFF;
+      }
+
+      return true;
+    }
+
+    *field.value = value * field.scale + (field.offset != nullptr ? *field.offset : 0);
+    return true;
+  }
+};
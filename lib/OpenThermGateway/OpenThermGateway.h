@@ -0,0 +1,172 @@
+#pragma once
+#include <Arduino.h>
+#include <CustomOpenTherm.h>
+#include <SpscQueue.h>
+
+#ifndef OT_GATEWAY_MAX_OVERRIDES
+  #define OT_GATEWAY_MAX_OVERRIDES 4
+#endif
+
+#ifndef OT_GATEWAY_QUEUE_SIZE
+  #define OT_GATEWAY_QUEUE_SIZE 8
+#endif
+
+// Pass-through between a master (room thermostat) and the slave (boiler):
+// rewrites the data of selected write ids and measures the time each frame spends in the gateway.
+class OpenThermGateway {
+public:
+  struct Frame {
+    unsigned long request;
+    unsigned long response;
+    OpenThermResponseStatus status;
+  };
+
+  // frames forwarded to the slave, for the policy task
+  SpscQueue<Frame, OT_GATEWAY_QUEUE_SIZE> observed;
+
+  void setActive(bool value) {
+    active = value;
+  }
+
+  bool isActive() {
+    return active;
+  }
+
+  // the slave gets this data instead of the one written by the master
+  void setOverride(OpenThermMessageID id, unsigned int data) {
+    Override* item = findOverride(id);
+    if (item == nullptr) {
+      item = findOverride(id, true);
+    }
+
+    if (item != nullptr) {
+      item->id = (byte) id;
+      item->data = data;
+      item->enabled = true;
+    }
+  }
+
+  void clearOverride(OpenThermMessageID id) {
+    Override* item = findOverride(id);
+    if (item != nullptr) {
+      item->enabled = false;
+    }
+  }
+
+  bool isPending() {
+    return pending;
+  }
+
+  // frame from the master, returns the frame for the slave
+  unsigned long handleRequest(unsigned long request, unsigned long now) {
+    pending = true;
+    original = request;
+    receivedTime = now;
+
+    Override* item = getMessageType(request) == OpenThermMessageType::WRITE_DATA ? findOverride((OpenThermMessageID) ((request >> 16) & 0xFF)) : nullptr;
+    overridden = item != nullptr;
+
+    return overridden ? withData(request, item->data) : request;
+  }
+
+  // response of the slave, returns the frame for the master (0 - no answer) and the time of the frame in the gateway
+  unsigned long handleResponse(unsigned long request, unsigned long response, OpenThermResponseStatus status, unsigned long slaveLatency, unsigned long now) {
+    pending = false;
+    observed.push({request, response, status});
+
+    if (status == OpenThermResponseStatus::TIMEOUT || status == OpenThermResponseStatus::NONE || CustomOpenTherm::parity(response)) {
+      failed++;
+      return 0;
+    }
+
+    unsigned long lastLatency = now - receivedTime;
+    unsigned long lastOverhead = lastLatency > slaveLatency ? lastLatency - slaveLatency : 0;
+
+    latency = frames == 0 ? lastLatency : latency + ((long) lastLatency - (long) latency) / 8;
+    overhead = frames == 0 ? lastOverhead : overhead + ((long) lastOverhead - (long) overhead) / 8;
+    maxLatency = max(maxLatency, lastLatency);
+    frames++;
+
+    // the master gets its own value back in the acknowledge
+    if (overridden && getMessageType(response) == OpenThermMessageType::WRITE_ACK) {
+      return withData(response, original & 0xFFFF);
+    }
+
+    return response;
+  }
+
+  // smoothed time from the request of the master to the response to it, ms
+  unsigned long getLatency() {
+    return latency;
+  }
+
+  // part of the latency added by the gateway, ms
+  unsigned long getOverhead() {
+    return overhead;
+  }
+
+  unsigned long getMaxLatency() {
+    return maxLatency;
+  }
+
+  unsigned long getFrames() {
+    return frames;
+  }
+
+  // slave did not answer, the master gets no response
+  unsigned long getFailed() {
+    return failed;
+  }
+
+  // the request of the master arrived while the previous one was still on the wire
+  void skipRequest() {
+    skipped++;
+  }
+
+  unsigned long getSkipped() {
+    return skipped;
+  }
+
+protected:
+  struct Override {
+    byte id;
+    unsigned int data;
+    bool enabled;
+  };
+
+  Override overrides[OT_GATEWAY_MAX_OVERRIDES] = {};
+  bool active = false;
+  bool pending = false;
+  bool overridden = false;
+  unsigned long original = 0;
+  unsigned long receivedTime = 0;
+  unsigned long latency = 0;
+  unsigned long overhead = 0;
+  unsigned long maxLatency = 0;
+  unsigned long frames = 0;
+  unsigned long failed = 0;
+  unsigned long skipped = 0;
+
+  Override* findOverride(OpenThermMessageID id, bool free = false) {
+    for (byte i = 0; i < OT_GATEWAY_MAX_OVERRIDES; i++) {
+      if (free ? !overrides[i].enabled : overrides[i].enabled && overrides[i].id == (byte) id) {
+        return &overrides[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  static OpenThermMessageType getMessageType(unsigned long frame) {
+    return (OpenThermMessageType) ((frame >> 28) & 0x7);
+  }
+
+  static unsigned long withData(unsigned long frame, unsigned int data) {
+    frame = (frame & 0x7FFF0000) | (data & 0xFFFF);
+    if (CustomOpenTherm::parity(frame)) {
+      frame |= 1UL << 31;
+    }
+
+    return frame;
+  }
+};
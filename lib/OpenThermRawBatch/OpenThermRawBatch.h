@@ -0,0 +1,127 @@
+#pragma once
+#include <Arduino.h>
+#include <OpenTherm.h>
+#include <atomic>
+
+#ifndef OT_RAW_MAX_FRAMES
+  #define OT_RAW_MAX_FRAMES 16
+#endif
+
+// bus time which can be saved up while idle, ms
+#ifndef OT_RAW_BUDGET_BURST
+  #define OT_RAW_BUDGET_BURST 5000
+#endif
+
+// Batch of raw diagnostic frames, sent one by one within a share of the bus time (token bucket).
+// One task fills the batch, queues it and publishes the result, the other one sends the queued frames.
+class OpenThermRawBatch {
+public:
+  enum class Stage : byte {
+    FILLING,
+    QUEUED,
+    FINISHED
+  };
+
+  struct Frame {
+    unsigned long request;
+    unsigned long response;
+    OpenThermResponseStatus status;
+  };
+
+  void setBudget(byte percent) {
+    budget = min(percent, (byte) 100);
+  }
+
+  bool add(unsigned long request) {
+    if (count >= OT_RAW_MAX_FRAMES) {
+      return false;
+    }
+
+    frames[count++] = {request, 0, OpenThermResponseStatus::NONE};
+    return true;
+  }
+
+  void clear() {
+    count = 0;
+    position = 0;
+    stage = Stage::FILLING;
+  }
+
+  // the frames are added, hands the batch over to the sender
+  void queue() {
+    if (count > 0) {
+      stage = Stage::QUEUED;
+    }
+  }
+
+  byte size() {
+    return count;
+  }
+
+  const Frame& get(byte index) {
+    return frames[index];
+  }
+
+  bool isEmpty() {
+    return count == 0;
+  }
+
+  bool isQueued() {
+    return stage == Stage::QUEUED;
+  }
+
+  // the responses are ready, hands the batch back
+  bool isFinished() {
+    return stage == Stage::FINISHED;
+  }
+
+  // next frame to send if the budget allows a frame of the given bus time, ms
+  Frame* take(unsigned long now, unsigned long cost) {
+    refill(now);
+
+    if (position >= count || budget == 0 || tokens < cost) {
+      return nullptr;
+    }
+
+    tokens -= cost;
+    return &frames[position];
+  }
+
+  // the frame returned by take() is not sent, its cost is given back and take() returns it again
+  void release(unsigned long cost) {
+    tokens = min(tokens + cost, (unsigned long) OT_RAW_BUDGET_BURST);
+  }
+
+  // the frame returned by take() is done, extra is the bus time above the estimated cost
+  void complete(unsigned long response, OpenThermResponseStatus status, unsigned long extra = 0) {
+    frames[position].response = response;
+    frames[position].status = status;
+    position++;
+
+    tokens = tokens > extra ? tokens - extra : 0;
+
+    if (position >= count) {
+      stage = Stage::FINISHED;
+    }
+  }
+
+  unsigned long getTokens() {
+    return tokens;
+  }
+
+protected:
+  Frame frames[OT_RAW_MAX_FRAMES];
+  byte count = 0;
+  byte position = 0;
+  std::atomic<Stage> stage{Stage::FILLING};
+  byte budget = 10;
+  unsigned long tokens = OT_RAW_BUDGET_BURST;
+  unsigned long refillTime = 0;
+
+  void refill(unsigned long now) {
+    unsigned long elapsed = min(now - refillTime, 3600000UL);
+    refillTime = now;
+
+    tokens = min(tokens + elapsed * budget / 100, (unsigned long) OT_RAW_BUDGET_BURST);
+  }
+};
@@ -0,0 +1,221 @@
+#pragma once
+#include <Arduino.h>
+#include <OpenTherm.h>
+
+#ifndef OT_SCHEDULER_MAX_ITEMS
+  #define OT_SCHEDULER_MAX_ITEMS 32
+#endif
+
+class OpenThermScheduler {
+public:
+  struct Item {
+    OpenThermMessageID id;
+    // 0 - highest
+    byte priority;
+    // desired interval between requests, ms
+    unsigned long period;
+    // max allowed interval between requests, ms (0 - no deadline)
+    unsigned long deadline;
+    unsigned long lastRun;
+    unsigned long missed;
+    bool enabled;
+    bool pending;
+    // only sent when no other item becomes due during the frame
+    bool lazy;
+  };
+
+  bool add(OpenThermMessageID id, byte priority, unsigned long period, unsigned long deadline = 0) {
+    if (count >= OT_SCHEDULER_MAX_ITEMS || find(id) >= 0) {
+      return false;
+    }
+
+    Item& item = items[count++];
+    item.id = id;
+    item.priority = priority;
+    item.period = period;
+    item.deadline = deadline;
+    item.lastRun = 0;
+    item.missed = 0;
+    item.enabled = true;
+    item.pending = true;
+    item.lazy = false;
+
+    return true;
+  }
+
+  // low priority item without a deadline, it only fills the slack of the bus
+  bool addLazy(OpenThermMessageID id, unsigned long period) {
+    if (!add(id, 255, period)) {
+      return false;
+    }
+
+    items[count - 1].lazy = true;
+    return true;
+  }
+
+  void setEnabled(OpenThermMessageID id, bool value) {
+    int index = find(id);
+    if (index < 0 || items[index].enabled == value) {
+      return;
+    }
+
+    items[index].enabled = value;
+
+    // a disabled item must not count as a missed deadline later
+    if (value) {
+      items[index].lastRun = 0;
+      items[index].pending = true;
+    }
+  }
+
+  bool isEnabled(OpenThermMessageID id) {
+    int index = find(id);
+    return index >= 0 && items[index].enabled;
+  }
+
+  void setPeriod(OpenThermMessageID id, unsigned long period) {
+    int index = find(id);
+    if (index >= 0) {
+      items[index].period = period;
+    }
+  }
+
+  // request as soon as possible (respecting priority)
+  void force(OpenThermMessageID id) {
+    int index = find(id);
+    if (index >= 0) {
+      items[index].pending = true;
+    }
+  }
+
+  // mark all items as due, e.g. after the link came up
+  void reset() {
+    for (byte i = 0; i < count; i++) {
+      items[i].pending = true;
+    }
+  }
+
+  // Most urgent due item or -1 if the bus can stay idle.
+  // window - expected duration of one frame. An item is held back if it would delay a more important one:
+  // lazy items yield to any regular item which becomes due within the window,
+  // the others only to the items which would miss their deadline.
+  int next(unsigned long now, unsigned long window = 0) {
+    int result = -1;
+    unsigned long resultLateness = 0;
+
+    for (byte i = 0; i < count; i++) {
+      Item& item = items[i];
+      if (!item.enabled || getDueIn(item, now) > 0) {
+        continue;
+      }
+
+      // pending items are the most late ones
+      unsigned long lateness = item.pending ? ~0UL : now - item.lastRun - item.period;
+      if (result < 0 || item.priority < items[result].priority || (item.priority == items[result].priority && lateness > resultLateness)) {
+        result = i;
+        resultLateness = lateness;
+      }
+    }
+
+    if (result < 0 || window == 0) {
+      return result;
+    }
+
+    // a lazy item waiting for more than its period stops yielding to the regular ones, it must not starve on a busy bus
+    bool lazy = items[result].lazy && now - items[result].lastRun < items[result].period * 2;
+
+    for (byte i = 0; i < count; i++) {
+      Item& item = items[i];
+      if (!item.enabled || item.lazy || item.priority >= items[result].priority) {
+        continue;
+      }
+
+      if (lazy ? getDueIn(item, now) <= window : getDeadlineIn(item, now) <= window) {
+        return -1;
+      }
+    }
+
+    return result;
+  }
+
+  // true if a frame outside of the poll plan can be sent now: no item more important than the priority
+  // is due or would miss its deadline within the window
+  bool isIdle(unsigned long now, unsigned long window, byte priority = 255) {
+    for (byte i = 0; i < count; i++) {
+      Item& item = items[i];
+      if (item.enabled && item.priority < priority && (getDueIn(item, now) == 0 || getDeadlineIn(item, now) <= window)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  byte size() {
+    return count;
+  }
+
+  OpenThermMessageID getId(int index) {
+    return items[index].id;
+  }
+
+  // call after the request has been processed, now - when it was queued,
+  // so the period and the deadline are measured between the starts of the requests
+  void done(int index, unsigned long now) {
+    Item& item = items[index];
+
+    if (item.deadline > 0 && item.lastRun > 0 && now - item.lastRun > item.deadline) {
+      item.missed++;
+      missedDeadlines++;
+    }
+
+    item.lastRun = now;
+    item.pending = false;
+  }
+
+  // the item was not sent (e.g. unsupported by the slave), no deadline accounting
+  void skip(int index, unsigned long now) {
+    items[index].lastRun = now;
+    items[index].pending = false;
+  }
+
+  unsigned long getMissedDeadlines() {
+    return missedDeadlines;
+  }
+
+  unsigned long getMissedDeadlines(OpenThermMessageID id) {
+    int index = find(id);
+    return index >= 0 ? items[index].missed : 0;
+  }
+
+protected:
+  Item items[OT_SCHEDULER_MAX_ITEMS];
+  byte count = 0;
+  unsigned long missedDeadlines = 0;
+
+  // 0 if the item is due
+  static unsigned long getDueIn(const Item& item, unsigned long now) {
+    unsigned long elapsed = now - item.lastRun;
+    return item.pending || elapsed >= item.period ? 0 : item.period - elapsed;
+  }
+
+  // time left to start the item without missing the deadline, ~0 if there is no deadline
+  static unsigned long getDeadlineIn(const Item& item, unsigned long now) {
+    if (item.deadline == 0) {
+      return ~0UL;
+    }
+
+    unsigned long elapsed = now - item.lastRun;
+    return item.pending || elapsed >= item.deadline ? 0 : item.deadline - elapsed;
+  }
+
+  int find(OpenThermMessageID id) {
+    for (byte i = 0; i < count; i++) {
+      if (items[i].id == id) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+};
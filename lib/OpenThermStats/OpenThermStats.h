@@ -0,0 +1,112 @@
+#pragma once
+#include <Arduino.h>
+#include <OpenTherm.h>
+
+#ifndef OT_STATS_MAX_IDS
+  #define OT_STATS_MAX_IDS 32
+#endif
+
+// latency buckets: <16, <32, <64, <128, <256, <512, <1024, >=1024 ms
+#define OT_STATS_BUCKETS 8
+#define OT_STATS_FIRST_BUCKET_BITS 4
+
+class OpenThermStats {
+public:
+  struct Item {
+    byte id;
+    uint32_t latency[OT_STATS_BUCKETS];
+    uint32_t success;
+    uint32_t invalid;
+    uint32_t timeout;
+    uint32_t retries;
+  };
+
+  // must be called for every attempt, latency is only counted for successful ones
+  void handleAttempt(unsigned long request, OpenThermResponseStatus status, byte attempt, unsigned long latency) {
+    Item* item = get((request >> 16) & 0xFF);
+    if (item == nullptr) {
+      overflow++;
+      return;
+    }
+
+    if (attempt > 1) {
+      item->retries++;
+    }
+
+    switch (status) {
+    case OpenThermResponseStatus::SUCCESS:
+      item->success++;
+      item->latency[getBucket(latency)]++;
+      break;
+
+    case OpenThermResponseStatus::INVALID:
+      item->invalid++;
+      break;
+
+    case OpenThermResponseStatus::TIMEOUT:
+      item->timeout++;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  void reset() {
+    count = 0;
+    overflow = 0;
+  }
+
+  byte size() {
+    return count;
+  }
+
+  const Item& getItem(byte index) {
+    return items[index];
+  }
+
+  // attempts of the ids that did not fit into the table
+  unsigned long getOverflow() {
+    return overflow;
+  }
+
+  // upper bound of the bucket, ms (0 - unbounded)
+  static unsigned int getBucketLimit(byte bucket) {
+    return bucket < OT_STATS_BUCKETS - 1 ? 1U << (bucket + OT_STATS_FIRST_BUCKET_BITS) : 0;
+  }
+
+  static byte getBucket(unsigned long latency) {
+    byte bucket = 0;
+    latency >>= OT_STATS_FIRST_BUCKET_BITS;
+
+    while (latency > 0 && bucket < OT_STATS_BUCKETS - 1) {
+      latency >>= 1;
+      bucket++;
+    }
+
+    return bucket;
+  }
+
+protected:
+  Item items[OT_STATS_MAX_IDS];
+  byte count = 0;
+  unsigned long overflow = 0;
+
+  Item* get(byte id) {
+    for (byte i = 0; i < count; i++) {
+      if (items[i].id == id) {
+        return &items[i];
+      }
+    }
+
+    if (count >= OT_STATS_MAX_IDS) {
+      return nullptr;
+    }
+
+    Item* item = &items[count++];
+    memset(item, 0, sizeof(Item));
+    item->id = id;
+
+    return item;
+  }
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <Arduino.h>
+#include <OpenTherm.h>
+#include <atomic>
+
+#ifndef OT_TRACE_SIZE
+  #if defined(ESP32)
+    #define OT_TRACE_SIZE 1024
+  #else
+    #define OT_TRACE_SIZE 256
+  #endif
+#endif
+
+class OpenThermTrace {
+public:
+  // 12 bytes per frame, the frames are stored as they were on the wire.
+  // info: bits 0-23 - millis() (wraps every 4.6 hours), 24-27 - attempt, 28-31 - status
+  struct Entry {
+    uint32_t info;
+    uint32_t request;
+    uint32_t response;
+  };
+  static_assert(sizeof(Entry) == 12, "the binary dump is 12 bytes per frame");
+
+  void record(unsigned long request, unsigned long response, OpenThermResponseStatus status, byte attempt) {
+    recording = true;
+    if (paused) {
+      recording = false;
+      return;
+    }
+
+    Entry& entry = entries[head];
+    entry.info = (millis() & 0xFFFFFF) | ((uint32_t) min(attempt, (byte) 15) << 24) | ((uint32_t) status & 0xF) << 28;
+    entry.request = request;
+    entry.response = response;
+
+    head = (head + 1) % OT_TRACE_SIZE;
+    if (count < OT_TRACE_SIZE) {
+      count++;
+    }
+
+    recording = false;
+  }
+
+  // stop recording while the buffer is being dumped,
+  // the transport records on the other core: wait for the frame being recorded now
+  void pause() {
+    paused = true;
+
+    while (recording) {
+      ::yield();
+    }
+  }
+
+  void resume() {
+    paused = false;
+  }
+
+  void clear() {
+    head = 0;
+    count = 0;
+  }
+
+  unsigned int size() {
+    return count;
+  }
+
+  // 0 - the oldest entry
+  const Entry& get(unsigned int index) {
+    return entries[(head + OT_TRACE_SIZE - count + index) % OT_TRACE_SIZE];
+  }
+
+  static unsigned long getTs(const Entry& entry) {
+    return entry.info & 0xFFFFFF;
+  }
+
+  static unsigned long getRequest(const Entry& entry) {
+    return entry.request;
+  }
+
+  static unsigned long getResponse(const Entry& entry) {
+    return entry.response;
+  }
+
+  static byte getAttempt(const Entry& entry) {
+    return (entry.info >> 24) & 0xF;
+  }
+
+  static OpenThermResponseStatus getStatus(const Entry& entry) {
+    return (OpenThermResponseStatus) (entry.info >> 28);
+  }
+
+  static const char* getStatusName(const Entry& entry) {
+    switch (getStatus(entry)) {
+      case OpenThermResponseStatus::SUCCESS: return "SUCCESS";
+      case OpenThermResponseStatus::INVALID: return "INVALID";
+      case OpenThermResponseStatus::TIMEOUT: return "TIMEOUT";
+      default: return "NONE";
+    }
+  }
+
+protected:
+  Entry entries[OT_TRACE_SIZE];
+  unsigned int head = 0;
+  unsigned int count = 0;
+  std::atomic<bool> paused{false};
+  std::atomic<bool> recording{false};
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <Arduino.h>
+#include <CustomOpenTherm.h>
+#include <SpscQueue.h>
+
+#ifndef OT_TRANSPORT_QUEUE_SIZE
+  #define OT_TRANSPORT_QUEUE_SIZE 4
+#endif
+
+// one queue per producer task
+#define OT_TRANSPORT_CONTROL    0
+#define OT_TRANSPORT_ACTIONS    1
+#define OT_TRANSPORT_PRODUCERS  2
+
+class OpenThermTransport {
+public:
+  typedef CustomOpenTherm::Request Request;
+
+  // Producer side, every queue must be used from a single task only.
+  // The request must stay alive and untouched until request.isDone(), completeCallback runs in the transport task before isDone() turns true.
+  bool submit(byte producer, Request& request) {
+    if (producer >= OT_TRANSPORT_PRODUCERS) {
+      return false;
+    }
+
+    request.state = CustomOpenTherm::RequestState::WAITING;
+    if (!queues[producer].push(&request)) {
+      request.state = CustomOpenTherm::RequestState::IDLE;
+      rejected++;
+
+      return false;
+    }
+
+    return true;
+  }
+
+  // Transport side: starts the next queued request if the bus is free.
+  // The queues are served round-robin, so a request waits for at most one frame of every other producer.
+  bool dispatch(CustomOpenTherm* ot) {
+    if (ot->isBusy()) {
+      return false;
+    }
+
+    for (byte i = 0; i < OT_TRANSPORT_PRODUCERS; i++) {
+      byte index = (nextQueue + i) % OT_TRANSPORT_PRODUCERS;
+      Request* request;
+
+      if (queues[index].pop(request)) {
+        nextQueue = (index + 1) % OT_TRANSPORT_PRODUCERS;
+        return ot->sendRequestAsync(*request);
+      }
+    }
+
+    return false;
+  }
+
+  // requests refused because the queue was full
+  unsigned long getRejected() {
+    return rejected;
+  }
+
+protected:
+  SpscQueue<Request*, OT_TRANSPORT_QUEUE_SIZE> queues[OT_TRANSPORT_PRODUCERS];
+  byte nextQueue = 0;
+  volatile unsigned long rejected = 0;
+};
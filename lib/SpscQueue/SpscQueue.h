@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free ring buffer for exactly one producer task and one consumer task.
+template <class T, unsigned int N>
+class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of 2");
+
+public:
+  // producer side
+  bool push(const T& item) {
+    unsigned int _head = head.load(std::memory_order_relaxed);
+    if (_head - tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+
+    items[_head & (N - 1)] = item;
+    head.store(_head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // consumer side
+  bool pop(T& item) {
+    unsigned int _tail = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == _tail) {
+      return false;
+    }
+
+    item = items[_tail & (N - 1)];
+    tail.store(_tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  bool isEmpty() {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+protected:
+  T items[N];
+  std::atomic<unsigned int> head{0};
+  std::atomic<unsigned int> tail{0};
+};
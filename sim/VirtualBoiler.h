@@ -0,0 +1,315 @@
+#pragma once
+// Simulated OpenTherm slave with a simple thermal model of the boiler and the heated room.
+#include <Arduino.h>
+#include <OpenTherm.h>
+
+class VirtualBoiler : public OpenThermBus {
+public:
+  struct {
+    // slave response latency range, ms (the spec allows 20..800)
+    unsigned long latencyMin = 40;
+    unsigned long latencyMax = 80;
+    // probability of a lost response / corrupted parity, %
+    byte dropRate = 0;
+    byte corruptRate = 0;
+    byte memberId = 0;
+    bool dhwPresent = true;
+    byte minModulation = 10;
+    // flow temperature rise at 100% modulation, °C/s
+    float heatRate = 0.5;
+    // flow heat loss to the room, 1/s
+    float flowLoss = 0.01;
+    // room heat gain from the radiators and loss to the outside, 1/s
+    float roomGain = 0.0003;
+    float roomLoss = 0.0003;
+  } config;
+
+  struct {
+    bool chEnable = false;
+    bool dhwEnable = false;
+    bool ch2Enable = false;
+    float tSet = 0;
+    float tSetCh2 = 0;
+    float tDhwSet = 50;
+    float maxTSet = 80;
+    float maxModulation = 100;
+    byte memberId = 0;
+  } master;
+
+  float flowTemp = 20;
+  float dhwTemp = 45;
+  float indoorTemp = 20;
+  float outdoorTemp = 0;
+  float pressure = 1.5;
+  float modulation = 0;
+  bool flame = false;
+  bool fault = false;
+  bool online = true;
+
+  struct {
+    unsigned long requests = 0;
+    unsigned long dropped = 0;
+    unsigned long corrupted = 0;
+    unsigned long unknown = 0;
+    unsigned long flameStarts = 0;
+    unsigned long flameTime = 0;
+    // bus time: request + latency + response, ms
+    unsigned long busTime = 0;
+  } counters;
+
+  void setSeed(uint32_t value) {
+    seed = value != 0 ? value : 1;
+  }
+
+  void setUnsupported(byte id, bool value) {
+    if (value) {
+      unsupported[id >> 5] |= 1UL << (id & 31);
+
+    } else {
+      unsupported[id >> 5] &= ~(1UL << (id & 31));
+    }
+  }
+
+  bool isUnsupported(byte id) {
+    return unsupported[id >> 5] & (1UL << (id & 31));
+  }
+
+  // some slaves do not answer the ids they do not know
+  void setSilent(byte id, bool value) {
+    if (value) {
+      silent[id >> 5] |= 1UL << (id & 31);
+
+    } else {
+      silent[id >> 5] &= ~(1UL << (id & 31));
+    }
+  }
+
+  bool isSilent(byte id) {
+    return silent[id >> 5] & (1UL << (id & 31));
+  }
+
+  // integrates the thermal model up to the current virtual time
+  void update() {
+    unsigned long now = millis();
+    if (lastUpdate == 0) {
+      lastUpdate = now;
+      return;
+    }
+
+    while (now - lastUpdate >= 100) {
+      step(0.1);
+      lastUpdate += 100;
+    }
+  }
+
+  bool transfer(unsigned long request, unsigned long& response, unsigned long& latency) override {
+    update();
+    counters.requests++;
+
+    if (!online || random(100) < config.dropRate || isSilent((request >> 16) & 0xFF)) {
+      counters.dropped++;
+      counters.busTime += OT_NATIVE_FRAME_TIME + 1000;
+      return false;
+    }
+
+    latency = config.latencyMin + random(config.latencyMax - config.latencyMin + 1);
+    response = handleRequest(request);
+    counters.busTime += OT_NATIVE_FRAME_TIME * 2 + latency;
+
+    if (random(100) < config.corruptRate) {
+      counters.corrupted++;
+      response ^= 1UL << 31;
+    }
+
+    return true;
+  }
+
+protected:
+  uint32_t unsupported[8] = {0};
+  uint32_t silent[8] = {0};
+  uint32_t seed = 1;
+  unsigned long lastUpdate = 0;
+  float integral = 0;
+
+  // deterministic xorshift, the scenarios must be reproducible
+  uint32_t random(uint32_t max) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    return max > 0 ? seed % max : 0;
+  }
+
+  void step(float dt) {
+    bool demand = master.chEnable && master.tSet > 0;
+    if (fault || !demand) {
+      flame = false;
+
+    } else if (!flame && flowTemp < master.tSet - 2) {
+      flame = true;
+      counters.flameStarts++;
+
+    } else if (flame && flowTemp > master.tSet + 5) {
+      flame = false;
+    }
+
+    if (flame) {
+      // PI controller of the burner
+      integral = constrain(integral + (master.tSet - flowTemp) * dt * 0.2f, 0.0f, 100.0f);
+      float target = constrain((master.tSet - flowTemp) * 10 + integral, (float) config.minModulation, max(master.maxModulation, (float) config.minModulation));
+      // the burner can not change the power instantly
+      modulation += constrain(target - modulation, -5 * dt, 5 * dt);
+      modulation = max(modulation, (float) config.minModulation);
+
+    } else {
+      modulation = 0;
+      integral = 0;
+    }
+
+    if (flame) {
+      counters.flameTime += dt * 1000;
+    }
+
+    flowTemp += (modulation / 100 * config.heatRate - (flowTemp - indoorTemp) * config.flowLoss) * dt;
+    indoorTemp += ((flowTemp - indoorTemp) * config.roomGain - (indoorTemp - outdoorTemp) * config.roomLoss) * dt;
+  }
+
+  unsigned long handleRequest(unsigned long request) {
+    OpenThermMessageType type = OpenTherm::getMessageType(request);
+    OpenThermMessageID id = OpenTherm::getDataID(request);
+    unsigned int data = request & 0xFFFF;
+
+    if (OpenTherm::parity(request) || (type != OpenThermMessageType::READ_DATA && type != OpenThermMessageType::WRITE_DATA)) {
+      return OpenTherm::buildResponse(OpenThermMessageType::DATA_INVALID, id, data);
+    }
+
+    if (isUnsupported((byte) id)) {
+      counters.unknown++;
+      return OpenTherm::buildResponse(OpenThermMessageType::UNKNOWN_DATA_ID, id, 0);
+    }
+
+    bool write = type == OpenThermMessageType::WRITE_DATA;
+    OpenThermMessageType ack = write ? OpenThermMessageType::WRITE_ACK : OpenThermMessageType::READ_ACK;
+    float value = ((int16_t) data) / 256.0f;
+
+    switch (id) {
+    case OpenThermMessageID::Status:
+      master.chEnable = data & 0x100;
+      master.dhwEnable = data & 0x200;
+      master.ch2Enable = data & 0x1000;
+      return OpenTherm::buildResponse(ack, id, (data & 0xFF00) | getSlaveFlags());
+
+    case OpenThermMessageID::TSet:
+      if (write) {
+        master.tSet = min(value, master.maxTSet);
+      }
+      return OpenTherm::buildResponse(ack, id, write ? data : toF88(master.tSet));
+
+    case OpenThermMessageID::TsetCH2:
+      if (write) {
+        master.tSetCh2 = value;
+      }
+      return OpenTherm::buildResponse(ack, id, write ? data : toF88(master.tSetCh2));
+
+    case OpenThermMessageID::MConfigMMemberIDcode:
+      if (write) {
+        master.memberId = data & 0xFF;
+      }
+      return OpenTherm::buildResponse(ack, id, write ? data : master.memberId);
+
+    case OpenThermMessageID::SConfigSMemberIDcode:
+      return OpenTherm::buildResponse(ack, id, (config.dhwPresent << 8) | config.memberId);
+
+    case OpenThermMessageID::Command:
+      // 1 - boiler lock-out reset
+      if ((data >> 8) == 1) {
+        fault = false;
+      }
+      return OpenTherm::buildResponse(ack, id, data & 0xFF00);
+
+    case OpenThermMessageID::ASFflags:
+      return OpenTherm::buildResponse(ack, id, fault ? 0x0100 | 0x01 : 0);
+
+    case OpenThermMessageID::MaxRelModLevelSetting:
+      if (write) {
+        master.maxModulation = value;
+      }
+      return OpenTherm::buildResponse(ack, id, write ? data : toF88(master.maxModulation));
+
+    case OpenThermMessageID::RelModLevel:
+      return OpenTherm::buildResponse(ack, id, toF88(modulation));
+
+    case OpenThermMessageID::CHPressure:
+      return OpenTherm::buildResponse(ack, id, toF88(pressure));
+
+    case OpenThermMessageID::DHWFlowRate:
+      return OpenTherm::buildResponse(ack, id, toF88(master.dhwEnable && flame ? 6.5 : 0));
+
+    case OpenThermMessageID::Tboiler:
+      return OpenTherm::buildResponse(ack, id, toF88(flowTemp));
+
+    case OpenThermMessageID::Tret:
+      return OpenTherm::buildResponse(ack, id, toF88(flowTemp - (flowTemp - indoorTemp) * 0.25));
+
+    case OpenThermMessageID::Texhaust:
+      return OpenTherm::buildResponse(ack, id, (unsigned int) (int16_t) round(flowTemp + modulation * 0.5) & 0xFFFF);
+
+    case OpenThermMessageID::OEMDiagnosticCode:
+      return OpenTherm::buildResponse(ack, id, fault ? 101 : 0);
+
+    case OpenThermMessageID::BurnerStarts:
+    case OpenThermMessageID::CHPumpStarts:
+      return OpenTherm::buildResponse(ack, id, counters.flameStarts & 0xFFFF);
+
+    case OpenThermMessageID::BurnerOperationHours:
+    case OpenThermMessageID::CHPumpOperationHours:
+      return OpenTherm::buildResponse(ack, id, (counters.flameTime / 3600000) & 0xFFFF);
+
+    case OpenThermMessageID::Tdhw:
+      return OpenTherm::buildResponse(ack, id, toF88(dhwTemp));
+
+    case OpenThermMessageID::Toutside:
+      return OpenTherm::buildResponse(ack, id, toF88(outdoorTemp));
+
+    case OpenThermMessageID::TdhwSetUBTdhwSetLB:
+      return OpenTherm::buildResponse(ack, id, (60 << 8) | 30);
+
+    case OpenThermMessageID::MaxTSetUBMaxTSetLB:
+      return OpenTherm::buildResponse(ack, id, (80 << 8) | 20);
+
+    case OpenThermMessageID::TdhwSet:
+      if (write) {
+        master.tDhwSet = value;
+      }
+      return OpenTherm::buildResponse(ack, id, write ? data : toF88(master.tDhwSet));
+
+    case OpenThermMessageID::MaxTSet:
+      if (write) {
+        master.maxTSet = value;
+      }
+      return OpenTherm::buildResponse(ack, id, write ? data : toF88(master.maxTSet));
+
+    case OpenThermMessageID::OpenThermVersionSlave:
+      return OpenTherm::buildResponse(ack, id, toF88(2.2));
+
+    case OpenThermMessageID::SlaveVersion:
+      return OpenTherm::buildResponse(ack, id, 0x0101);
+
+    case OpenThermMessageID::OpenThermVersionMaster:
+    case OpenThermMessageID::MasterVersion:
+      return OpenTherm::buildResponse(ack, id, data);
+
+    default:
+      counters.unknown++;
+      return OpenTherm::buildResponse(OpenThermMessageType::UNKNOWN_DATA_ID, id, 0);
+    }
+  }
+
+  unsigned int getSlaveFlags() {
+    return fault | ((master.chEnable && flame) << 1) | ((master.dhwEnable && config.dhwPresent) << 2) | (flame << 3);
+  }
+
+  static unsigned int toF88(float value) {
+    return (unsigned int) (int16_t) round(value * 256) & 0xFFFF;
+  }
+};
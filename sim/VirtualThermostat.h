@@ -0,0 +1,118 @@
+#pragma once
+// Simulated room thermostat: the OpenTherm master behind the gateway.
+// Sends one frame per period and checks the answers as a real thermostat would.
+#include <Arduino.h>
+#include <OpenTherm.h>
+
+class VirtualThermostat : public OpenThermMaster {
+public:
+  struct {
+    bool enabled = false;
+    bool chEnable = true;
+    float tSet = 45;
+    float maxModulation = 100;
+    // time between the requests, ms
+    unsigned long period = 1000;
+    // the slave must answer within 800 ms
+    unsigned long timeout = 800;
+  } config;
+
+  struct {
+    unsigned long requests = 0;
+    unsigned long responses = 0;
+    unsigned long timeouts = 0;
+    // invalid parity, other id or not the own value in the write acknowledge
+    unsigned long mismatches = 0;
+    // from the start of the request to the end of the response, ms
+    unsigned long maxLatency = 0;
+    unsigned long totalLatency = 0;
+  } counters;
+
+  void update() {
+    OpenTherm* slave = OpenTherm::slave();
+    if (!config.enabled || slave == nullptr) {
+      return;
+    }
+
+    OpenTherm::master() = this;
+    unsigned long now = millis();
+
+    if (waiting && now - sentTime > config.timeout) {
+      waiting = false;
+      counters.timeouts++;
+    }
+
+    if (waiting || now - sentTime < config.period) {
+      return;
+    }
+
+    request = buildRequest(sequence[position]);
+    position = (position + 1) % (sizeof(sequence) / sizeof(sequence[0]));
+
+    waiting = true;
+    sentTime = now;
+    counters.requests++;
+    slave->receiveRequest(request);
+  }
+
+  void handleResponse(unsigned long response) {
+    if (!waiting) {
+      return;
+    }
+
+    unsigned long latency = millis() - sentTime;
+    waiting = false;
+
+    if (latency > config.timeout) {
+      counters.timeouts++;
+      return;
+    }
+
+    counters.responses++;
+    counters.totalLatency += latency;
+    counters.maxLatency = max(counters.maxLatency, latency);
+
+    bool valid = !OpenTherm::parity(response) && ((response >> 16) & 0xFF) == ((request >> 16) & 0xFF);
+    if (valid && ((request >> 28) & 0x7) == (byte) OpenThermMessageType::WRITE_DATA) {
+      valid = (response & 0xFFFF) == (request & 0xFFFF);
+    }
+
+    if (!valid) {
+      counters.mismatches++;
+    }
+  }
+
+  float getAverageLatency() {
+    return counters.responses > 0 ? (float) counters.totalLatency / counters.responses : 0;
+  }
+
+protected:
+  const OpenThermMessageID sequence[6] = {
+    OpenThermMessageID::Status,
+    OpenThermMessageID::TSet,
+    OpenThermMessageID::MaxRelModLevelSetting,
+    OpenThermMessageID::Tboiler,
+    OpenThermMessageID::RelModLevel,
+    OpenThermMessageID::MaxTSetUBMaxTSetLB
+  };
+  byte position = 0;
+  bool waiting = false;
+  unsigned long request = 0;
+  unsigned long sentTime = 0;
+
+  unsigned long buildRequest(OpenThermMessageID id) {
+    switch (id) {
+    case OpenThermMessageID::Status:
+      return OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, id, (unsigned int) config.chEnable << 8);
+
+    case OpenThermMessageID::TSet:
+      return OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, id, (unsigned int) (config.tSet * 256));
+
+    case OpenThermMessageID::MaxRelModLevelSetting:
+      return OpenTherm::buildRequest(OpenThermMessageType::WRITE_DATA, id, (unsigned int) (config.maxModulation * 256));
+
+    default:
+      return OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, id, 0);
+    }
+  }
+};
@@ -0,0 +1,773 @@
+// Native simulator: runs the OpenTherm tasks and RegulatorTask against VirtualBoiler in virtual time.
+//
+//   pio run -e native
+//   .pio/build/native/program sim/scenarios/basic.txt [-v] [-q]
+//
+// Exit code is the number of failed "expect" lines of the scenario.
+#include "common.h"
+#include <EEManager.h>
+#include <Task.h>
+#include <LeanTask.h>
+#include <Scheduler.h>
+#include <chrono>
+#include <vector>
+#include "OpenThermTransportTask.h"
+#include "OpenThermTask.h"
+#include "RegulatorTask.h"
+#include "VirtualBoiler.h"
+#include "VirtualThermostat.h"
+
+Variables vars;
+Settings settings;
+BoilerProfile boilerProfile;
+EEManager eeSettings(settings, 60000);
+EEManager eeProfile(boilerProfile, 60000);
+TinyLogger Log = TinyLogger();
+
+OpenThermTransportTask* tOtTransport;
+OpenThermTask* tOt;
+RegulatorTask* tRegulator;
+VirtualBoiler boiler;
+VirtualThermostat thermostat;
+
+// raw frames answered by the boiler, counted when the batch is finished as the MqttTask publishes it
+struct {
+  unsigned long answered = 0;
+  unsigned long batches = 0;
+} simRaw;
+
+
+struct ScenarioLine {
+  unsigned long ts;
+  std::string command;
+  std::vector<std::string> args;
+  unsigned int lineNumber;
+};
+
+// float and bool settings which can be changed by the scenario
+struct {
+  const char* name;
+  float* floatValue;
+  bool* boolValue;
+  byte* byteValue;
+} const settingsMap[] = {
+  {"debug", nullptr, &settings.debug, nullptr},
+  {"heating.enable", nullptr, &settings.heating.enable, nullptr},
+  {"heating.turbo", nullptr, &settings.heating.turbo, nullptr},
+  {"heating.target", &settings.heating.target, nullptr, nullptr},
+  {"heating.hysteresis", &settings.heating.hysteresis, nullptr, nullptr},
+  {"heating.setpointStep", &settings.heating.setpointStep, nullptr, nullptr},
+  {"heating.setpointDeadband", &settings.heating.setpointDeadband, nullptr, nullptr},
+  {"heating.minTemp", nullptr, nullptr, &settings.heating.minTemp},
+  {"heating.maxTemp", nullptr, nullptr, &settings.heating.maxTemp},
+  {"heating.maxModulation", nullptr, nullptr, &settings.heating.maxModulation},
+  {"dhw.enable", nullptr, &settings.dhw.enable, nullptr},
+  {"dhw.target", nullptr, nullptr, &settings.dhw.target},
+  {"pid.enable", nullptr, &settings.pid.enable, nullptr},
+  {"pid.p", &settings.pid.p_factor, nullptr, nullptr},
+  {"pid.i", &settings.pid.i_factor, nullptr, nullptr},
+  {"pid.d", &settings.pid.d_factor, nullptr, nullptr},
+  {"equitherm.enable", nullptr, &settings.equitherm.enable, nullptr},
+  {"equitherm.n", &settings.equitherm.n_factor, nullptr, nullptr},
+  {"equitherm.k", &settings.equitherm.k_factor, nullptr, nullptr},
+  {"equitherm.t", &settings.equitherm.t_factor, nullptr, nullptr},
+  {"opentherm.adaptivePacing", nullptr, &settings.opentherm.adaptivePacing, nullptr},
+  {"opentherm.dhwPresent", nullptr, &settings.opentherm.dhwPresent, nullptr},
+  {"opentherm.inPin", nullptr, nullptr, &settings.opentherm.inPin},
+  {"opentherm.outPin", nullptr, nullptr, &settings.opentherm.outPin},
+  {"opentherm.gateway", nullptr, &settings.opentherm.gateway, nullptr},
+  {"opentherm.gatewayInPin", nullptr, nullptr, &settings.opentherm.gatewayInPin},
+  {"opentherm.gatewayOutPin", nullptr, nullptr, &settings.opentherm.gatewayOutPin},
+  {"opentherm.overrideTSet", nullptr, &settings.opentherm.overrideTSet, nullptr},
+  {"opentherm.overrideMaxModulation", nullptr, &settings.opentherm.overrideMaxModulation, nullptr},
+  {"opentherm.rawBudget", nullptr, nullptr, &settings.opentherm.rawBudget},
+  {"sensors.outdoor.type", nullptr, nullptr, &settings.sensors.outdoor.type},
+  {"tuning.enable", nullptr, &vars.tuning.enable, nullptr},
+  {"tuning.regulator", nullptr, nullptr, &vars.tuning.regulator}
+};
+
+unsigned long countTimeouts() {
+  unsigned long result = 0;
+  for (byte i = 0; i < otStats.size(); i++) {
+    result += otStats.getItem(i).timeout;
+  }
+
+  return result;
+}
+
+unsigned long countRequests(OpenThermMessageID id) {
+  for (byte i = 0; i < otStats.size(); i++) {
+    const OpenThermStats::Item& item = otStats.getItem(i);
+    if (item.id == (byte) id) {
+      return item.success + item.invalid + item.timeout;
+    }
+  }
+
+  return 0;
+}
+
+unsigned int countUnsupported() {
+  unsigned int result = 0;
+  for (unsigned int id = 0; id < 256; id++) {
+    result += otCapabilities.isUnsupported((OpenThermMessageID) id);
+  }
+
+  return result;
+}
+
+bool getMetric(const std::string& name, float& value) {
+  if (name == "flow") value = boiler.flowTemp;
+  else if (name == "indoor") value = boiler.indoorTemp;
+  else if (name == "outdoor") value = vars.temperatures.outdoor;
+  else if (name == "heating") value = vars.temperatures.heating;
+  else if (name == "setpoint") value = vars.parameters.heatingSetpoint;
+  else if (name == "tset") value = boiler.master.tSet;
+  else if (name == "maxModulation") value = boiler.master.maxModulation;
+  else if (name == "modulation") value = vars.sensors.modulation;
+  else if (name == "otStatus") value = vars.states.otStatus;
+  else if (name == "flame") value = vars.states.flame;
+  else if (name == "fault") value = vars.states.fault;
+  else if (name == "flameStarts") value = boiler.counters.flameStarts;
+  else if (name == "returnTemp") value = vars.telemetry.returnTemp;
+  else if (name == "exhaustTemp") value = vars.telemetry.exhaustTemp;
+  else if (name == "burnerStarts") value = vars.telemetry.burnerStarts;
+  else if (name == "requests") value = boiler.counters.requests;
+  else if (name == "timeouts") value = countTimeouts();
+  else if (name == "missedDeadlines") value = vars.opentherm.missedDeadlines;
+  else if (name == "skippedWrites") value = vars.opentherm.skippedWrites;
+  else if (name == "latency") value = vars.opentherm.latency;
+  else if (name == "frameGap") value = vars.opentherm.frameGap;
+  else if (name == "eepromUpdates") value = eeSettings.getUpdates();
+  else if (name == "probed") value = boilerProfile.probed;
+  else if (name == "probeTime") value = vars.opentherm.probeTime;
+  else if (name == "unsupportedIds") value = countUnsupported();
+  else if (name == "readyTime") value = vars.opentherm.readyTime;
+  else if (name == "startupTime") value = vars.opentherm.startupTime;
+  else if (name == "busTx") value = vars.opentherm.busTx;
+  else if (name == "busRx") value = vars.opentherm.busRx;
+  else if (name == "busGap") value = vars.opentherm.busGap;
+  else if (name == "busRetry") value = vars.opentherm.busRetry;
+  else if (name == "busLoad") value = vars.opentherm.busTx + vars.opentherm.busRx + vars.opentherm.busGap + vars.opentherm.busRetry;
+  else if (name == "unknownRequests") value = boiler.counters.unknown;
+  else if (name == "configReads") value = countRequests(OpenThermMessageID::SConfigSMemberIDcode);
+  else if (name == "memberIdSaved") value = vars.opentherm.memberIdSavedPerHour;
+  else if (name == "thermostatRequests") value = thermostat.counters.requests;
+  else if (name == "thermostatTimeouts") value = thermostat.counters.timeouts;
+  else if (name == "thermostatMismatches") value = thermostat.counters.mismatches;
+  else if (name == "thermostatLatency") value = thermostat.getAverageLatency();
+  else if (name == "thermostatMaxLatency") value = thermostat.counters.maxLatency;
+  else if (name == "gatewayLatency") value = vars.opentherm.gatewayLatency;
+  else if (name == "gatewayOverhead") value = vars.opentherm.gatewayOverhead;
+  else if (name == "rawAnswered") value = simRaw.answered;
+  else if (name == "rawBatches") value = simRaw.batches;
+  else if (name == "kn") value = settings.equitherm.n_factor;
+  else if (name == "kk") value = settings.equitherm.k_factor;
+  else if (name == "tuning") value = vars.tuning.enable;
+  else if (name == "tuningState") value = vars.tuning.state;
+  else if (name == "tuningSteps") value = vars.tuning.steps;
+  else if (name == "tuningError") value = vars.tuning.error;
+  else return false;
+
+  return true;
+}
+
+bool compare(float left, const std::string& op, float right) {
+  if (op == "<") return left < right;
+  if (op == "<=") return left <= right;
+  if (op == ">") return left > right;
+  if (op == ">=") return left >= right;
+  if (op == "==") return fabs(left - right) < 0.001;
+  if (op == "!=") return fabs(left - right) >= 0.001;
+
+  return false;
+}
+
+
+class SimulatorTask : public LeanTask {
+public:
+  SimulatorTask(std::vector<ScenarioLine>& scenario) : LeanTask(true, 100), scenario(scenario) {}
+
+  bool isFinished() {
+    return finished;
+  }
+
+  unsigned int getFailed() {
+    return failed;
+  }
+
+protected:
+  std::vector<ScenarioLine>& scenario;
+  size_t position = 0;
+  bool finished = false;
+  unsigned int failed = 0;
+
+  const char* getTaskName() {
+    return "Simulator";
+  }
+
+  void loop() {
+    boiler.update();
+    thermostat.update();
+
+    // acts as the sensors task: manual indoor sensor and the outdoor sensor if it is not read from the boiler,
+    // a new value is taken only when it differs by 0.1 degree and then the regulator is notified
+    float indoor = boiler.indoorTemp + settings.sensors.indoor.offset;
+    if (fabs(vars.temperatures.indoor - indoor) > 0.099) {
+      vars.temperatures.indoor = indoor;
+      vars.actions.updateSetpoint = true;
+    }
+
+    float outdoor = boiler.outdoorTemp + settings.sensors.outdoor.offset;
+    if (settings.sensors.outdoor.type != 0 && fabs(vars.temperatures.outdoor - outdoor) > 0.099) {
+      vars.temperatures.outdoor = outdoor;
+      vars.actions.updateSetpoint = true;
+    }
+
+    // acts as the mqtt task: takes the finished batch of raw frames
+    if (otRawBatch.isFinished()) {
+      for (byte i = 0; i < otRawBatch.size(); i++) {
+        if (otRawBatch.get(i).status == OpenThermResponseStatus::SUCCESS) {
+          simRaw.answered++;
+        }
+      }
+
+      simRaw.batches++;
+      otRawBatch.clear();
+    }
+
+    while (position < scenario.size() && scenario[position].ts <= millis()) {
+      execute(scenario[position++]);
+    }
+
+    if (position >= scenario.size()) {
+      finished = true;
+    }
+  }
+
+  void execute(const ScenarioLine& line) {
+    const std::vector<std::string>& args = line.args;
+    auto arg = [&args](size_t index) -> float {
+      return index < args.size() ? atof(args[index].c_str()) : 0;
+    };
+
+    if (line.command == "seed") {
+      boiler.setSeed(arg(0));
+
+    } else if (line.command == "latency") {
+      boiler.config.latencyMin = arg(0);
+      boiler.config.latencyMax = max(arg(1), arg(0));
+
+    } else if (line.command == "drop") {
+      boiler.config.dropRate = arg(0);
+
+    } else if (line.command == "corrupt") {
+      boiler.config.corruptRate = arg(0);
+
+    } else if (line.command == "unsupported" || line.command == "supported") {
+      boiler.setUnsupported(arg(0), line.command == "unsupported");
+
+    } else if (line.command == "silent") {
+      boiler.setSilent(arg(0), args.size() < 2 || arg(1) != 0);
+
+    } else if (line.command == "slave") {
+      // member id and dhw flag of the slave config
+      boiler.config.memberId = arg(0);
+      boiler.config.dhwPresent = args.size() < 2 || arg(1) != 0;
+
+    } else if (line.command == "online") {
+      boiler.online = arg(0) != 0;
+
+    } else if (line.command == "fault") {
+      boiler.fault = arg(0) != 0;
+
+    } else if (line.command == "outdoor") {
+      boiler.outdoorTemp = arg(0);
+
+    } else if (line.command == "indoor") {
+      boiler.indoorTemp = arg(0);
+
+    } else if (line.command == "thermostat") {
+      thermostat.config.enabled = true;
+      thermostat.config.tSet = arg(0);
+      thermostat.config.chEnable = args.size() < 2 || arg(1) != 0;
+
+    } else if (line.command == "set") {
+      set(line);
+
+    } else if (line.command == "raw") {
+      // read frames of the ids, ignored while the previous batch is not finished
+      if (otRawBatch.isEmpty()) {
+        for (size_t i = 0; i < args.size(); i++) {
+          otRawBatch.add(CustomOpenTherm::buildRequest(OpenThermMessageType::READ_DATA, (OpenThermMessageID) arg(i), 0));
+        }
+
+        otRawBatch.queue();
+      }
+
+    } else if (line.command == "print") {
+      Log.sinfoln(
+        "SIM", PSTR("flow: %.1f, indoor: %.1f, outdoor: %.1f, setpoint: %.1f, flame: %d, modulation: %.0f, ot: %d, requests: %lu, timeouts: %lu, missed: %lu"),
+        boiler.flowTemp, boiler.indoorTemp, boiler.outdoorTemp, vars.parameters.heatingSetpoint, vars.states.flame,
+        vars.sensors.modulation, vars.states.otStatus, boiler.counters.requests, countTimeouts(), vars.opentherm.missedDeadlines
+      );
+
+    } else if (line.command == "expect") {
+      expect(line);
+
+    } else if (line.command == "end") {
+      position = scenario.size();
+
+    } else {
+      Log.serrorln("SIM", PSTR("Line %u: unknown command '%s'"), line.lineNumber, line.command.c_str());
+      failed++;
+    }
+  }
+
+  void set(const ScenarioLine& line) {
+    if (line.args.size() == 2) {
+      float value = atof(line.args[1].c_str());
+
+      for (auto& item : settingsMap) {
+        if (line.args[0] != item.name) {
+          continue;
+        }
+
+        if (item.floatValue != nullptr) {
+          *item.floatValue = value;
+
+        } else if (item.boolValue != nullptr) {
+          *item.boolValue = value != 0;
+
+        } else {
+          *item.byteValue = value;
+        }
+
+        // as the mqtt task after settings/set and state/set
+        vars.actions.updateSetpoint = true;
+        return;
+      }
+    }
+
+    Log.serrorln("SIM", PSTR("Line %u: invalid set"), line.lineNumber);
+    failed++;
+  }
+
+  void expect(const ScenarioLine& line) {
+    float value;
+    if (line.args.size() != 3 || !getMetric(line.args[0], value)) {
+      Log.serrorln("SIM", PSTR("Line %u: invalid expect"), line.lineNumber);
+      failed++;
+      return;
+    }
+
+    float expected = atof(line.args[2].c_str());
+    if (compare(value, line.args[1], expected)) {
+      Log.sinfoln("SIM", PSTR("PASS: %s %s %s (%.2f)"), line.args[0].c_str(), line.args[1].c_str(), line.args[2].c_str(), value);
+
+    } else {
+      Log.serrorln("SIM", PSTR("FAIL line %u: %s %s %s (%.2f)"), line.lineNumber, line.args[0].c_str(), line.args[1].c_str(), line.args[2].c_str(), value);
+      failed++;
+    }
+  }
+};
+
+
+// "<seconds> <command> [args...]", '#' starts a comment
+bool loadScenario(const char* path, std::vector<ScenarioLine>& scenario) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    return false;
+  }
+
+  char buffer[256];
+  unsigned int lineNumber = 0;
+  while (fgets(buffer, sizeof(buffer), file) != nullptr) {
+    lineNumber++;
+
+    char* comment = strchr(buffer, '#');
+    if (comment != nullptr) {
+      *comment = 0;
+    }
+
+    std::vector<std::string> tokens;
+    for (char* token = strtok(buffer, " \t\r\n"); token != nullptr; token = strtok(nullptr, " \t\r\n")) {
+      tokens.push_back(token);
+    }
+
+    if (tokens.size() < 2) {
+      continue;
+    }
+
+    ScenarioLine line;
+    line.ts = (unsigned long) (atof(tokens[0].c_str()) * 1000);
+    line.command = tokens[1];
+    line.args.assign(tokens.begin() + 2, tokens.end());
+    line.lineNumber = lineNumber;
+    scenario.push_back(line);
+  }
+
+  fclose(file);
+
+  // stable, the lines with the same time keep their order
+  std::stable_sort(scenario.begin(), scenario.end(), [](const ScenarioLine& a, const ScenarioLine& b) {
+    return a.ts < b.ts;
+  });
+
+  return true;
+}
+
+void printReport(double wallSeconds) {
+  double simSeconds = millis() / 1000.0;
+
+  printf("\n=== Simulation ===\n");
+  printf("Virtual time:      %10.1f s\n", simSeconds);
+  printf("Wall time:         %10.3f s (x%.0f)\n", wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0);
+
+  printf("\n=== Tasks (wall time per loop) ===\n");
+  for (const auto& item : Scheduler.getStats()) {
+    printf("%-20s calls: %10lu   avg: %8.3f us   max: %8.3f us\n", item.name, item.calls, item.calls > 0 ? item.totalUs / item.calls : 0, item.maxUs);
+  }
+
+  printf("\n=== Bus ===\n");
+  printf("Requests:          %10lu (%.2f frames/s)\n", boiler.counters.requests, simSeconds > 0 ? boiler.counters.requests / simSeconds : 0);
+  printf("Bus busy:          %10.1f %%\n", simSeconds > 0 ? boiler.counters.busTime / 10.0 / simSeconds : 0);
+  printf("Last minute:       tx %.1f %%, rx %.1f %%, gap %.1f %%, retry %.1f %%\n", vars.opentherm.busTx, vars.opentherm.busRx, vars.opentherm.busGap, vars.opentherm.busRetry);
+  printf("Dropped:           %10lu\n", boiler.counters.dropped);
+  printf("Corrupted:         %10lu\n", boiler.counters.corrupted);
+  printf("Unknown id:        %10lu\n", boiler.counters.unknown);
+  printf("Skipped writes:    %10lu\n", vars.opentherm.skippedWrites);
+  printf("Missed deadlines:  %10lu\n", vars.opentherm.missedDeadlines);
+  printf("Latency (avg):     %10lu ms, frame gap: %lu ms\n", vars.opentherm.latency, vars.opentherm.frameGap);
+  printf("Flame starts:      %10lu\n", boiler.counters.flameStarts);
+
+  if (thermostat.config.enabled) {
+    printf("\n=== Gateway ===\n");
+    printf("Thermostat frames: %10lu, answered: %lu, timeouts: %lu, mismatches: %lu\n", thermostat.counters.requests, thermostat.counters.responses, thermostat.counters.timeouts, thermostat.counters.mismatches);
+    printf("Thermostat latency:%10.1f ms, max: %lu ms\n", thermostat.getAverageLatency(), thermostat.counters.maxLatency);
+    printf("Gateway latency:   %10lu ms, overhead: %lu ms, max: %lu ms\n", vars.opentherm.gatewayLatency, vars.opentherm.gatewayOverhead, vars.opentherm.gatewayMaxLatency);
+  }
+
+  printf("\n=== Per DataID ===\n");
+  printf("%4s %10s %10s %10s %10s\n", "ID", "success", "invalid", "timeout", "retries");
+  for (byte i = 0; i < otStats.size(); i++) {
+    const OpenThermStats::Item& item = otStats.getItem(i);
+    printf("%4u %10u %10u %10u %10u\n", item.id, item.success, item.invalid, item.timeout, item.retries);
+  }
+}
+
+// bit by bit versions, as in the OpenTherm library
+static bool referenceParity(unsigned long frame) {
+  byte p = 0;
+  while (frame > 0) {
+    if (frame & 1) {
+      p++;
+    }
+
+    frame >>= 1;
+  }
+
+  return p & 1;
+}
+
+static bool referenceValidResponse(unsigned long request, unsigned long response) {
+  if (referenceParity(response)) {
+    return false;
+  }
+
+  OpenThermMessageType type = OpenTherm::getMessageType(response);
+  if (type != OpenThermMessageType::READ_ACK && type != OpenThermMessageType::WRITE_ACK) {
+    return false;
+  }
+
+  if (OpenTherm::getDataID(request) != OpenTherm::getDataID(response)) {
+    return false;
+  }
+
+  return (OpenTherm::getMessageType(request) == OpenThermMessageType::WRITE_DATA) == (type == OpenThermMessageType::WRITE_ACK);
+}
+
+// heating curve as Equitherm computed it on every call
+static float referenceCurve(float kn, float outdoor) {
+  float a = (-0.21 * kn) - 0.06;
+  float b = (6.04 * kn) + 1.98;
+  float c = (-5.06 * kn) + 18.06;
+  float x = (-0.2 * outdoor) + 5;
+  return (a * x * x) + (b * x) + c;
+}
+
+// float that counts its operations: without an FPU every one of them is a library call
+struct CountingFloat {
+  static unsigned long operations;
+  float value = 0;
+
+  CountingFloat() {}
+  CountingFloat(int v) : value(v) {}
+  CountingFloat(float v) : value(v) {}
+  CountingFloat(double v) : value(v) {}
+
+  static CountingFloat count(float v) {
+    operations++;
+    return CountingFloat(v);
+  }
+
+  explicit operator float() const { return value; }
+  explicit operator int() const { operations++; return (int) value; }
+
+  CountingFloat operator-() const { return count(-value); }
+  CountingFloat operator+(const CountingFloat& other) const { return count(value + other.value); }
+  CountingFloat operator-(const CountingFloat& other) const { return count(value - other.value); }
+  CountingFloat operator*(const CountingFloat& other) const { return count(value * other.value); }
+  CountingFloat operator/(const CountingFloat& other) const { return count(value / other.value); }
+  bool operator==(const CountingFloat& other) const { operations++; return value == other.value; }
+  bool operator!=(const CountingFloat& other) const { operations++; return value != other.value; }
+  bool operator<(const CountingFloat& other) const { operations++; return value < other.value; }
+  bool operator>(const CountingFloat& other) const { operations++; return value > other.value; }
+};
+
+unsigned long CountingFloat::operations = 0;
+
+template <class F>
+double measure(const std::vector<unsigned long>& frames, unsigned int rounds, F func) {
+  volatile unsigned long sink = 0;
+  unsigned long result = 0;
+
+  auto started = std::chrono::steady_clock::now();
+  for (unsigned int round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < frames.size(); i++) {
+      result += func(frames[i], frames[(i + 1) % frames.size()]);
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - started;
+  sink = result;
+  (void) sink;
+
+  return elapsed.count() / ((double) rounds * frames.size());
+}
+
+// parity and response validation of CustomOpenTherm against the library versions
+int runBenchmark() {
+  // requests, each one followed by its response, every third response has a flipped bit
+  std::vector<unsigned long> frames(4096);
+  uint32_t state = 1;
+
+  for (size_t i = 0; i < frames.size(); i++) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    if (i % 2 == 0) {
+      OpenThermMessageType type = state & 0x1000000 ? OpenThermMessageType::WRITE_DATA : OpenThermMessageType::READ_DATA;
+      frames[i] = CustomOpenTherm::buildRequest(type, (OpenThermMessageID) ((state >> 16) & 0xFF), state & 0xFFFF);
+      continue;
+    }
+
+    unsigned long request = frames[i - 1];
+    OpenThermMessageType type = OpenTherm::getMessageType(request) == OpenThermMessageType::WRITE_DATA ? OpenThermMessageType::WRITE_ACK : OpenThermMessageType::READ_ACK;
+    frames[i] = CustomOpenTherm::buildResponse(type, OpenTherm::getDataID(request), state & 0xFFFF);
+
+    if (i % 6 == 1) {
+      frames[i] ^= 1UL << ((state >> 8) % 32);
+    }
+  }
+
+  unsigned int mismatches = 0;
+  for (size_t i = 0; i < frames.size(); i += 2) {
+    unsigned long request = frames[i];
+    unsigned long response = frames[i + 1];
+
+    mismatches += CustomOpenTherm::parity(request) != referenceParity(request);
+    mismatches += CustomOpenTherm::parity(response) != referenceParity(response);
+    mismatches += CustomOpenTherm::isValidResponse(request, response) != referenceValidResponse(request, response);
+    mismatches += CustomOpenTherm::buildRequest(OpenTherm::getMessageType(request), OpenTherm::getDataID(request), request & 0xFFFF) != OpenTherm::buildRequest(OpenTherm::getMessageType(request), OpenTherm::getDataID(request), request & 0xFFFF);
+  }
+
+  const unsigned int rounds = 2000;
+  printf("%-26s %10s %10s\n", "ns per frame", "library", "custom");
+  printf("%-26s %10.2f %10.2f\n", "parity",
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return referenceParity(a); }),
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return CustomOpenTherm::parity(a); })
+  );
+  printf("%-26s %10.2f %10.2f\n", "buildRequest",
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return OpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenTherm::getDataID(a), a & 0xFFFF); }),
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return CustomOpenTherm::buildRequest(OpenThermMessageType::READ_DATA, OpenTherm::getDataID(a), a & 0xFFFF); })
+  );
+  printf("%-26s %10.2f %10.2f\n", "isValidResponse(req, resp)",
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return referenceValidResponse(a, b); }),
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return CustomOpenTherm::isValidResponse(a, b); })
+  );
+  printf("Mismatches: %u\n", mismatches);
+
+  // heating curve: the table of Equitherm against the polynomial
+  Equitherm equitherm;
+  float maxError = 0;
+  for (float kn = 0.5f; kn <= 5; kn += 0.5f) {
+    equitherm.Kn = kn;
+
+    for (float outdoor = EQUITHERM_TABLE_MIN; outdoor <= EQUITHERM_TABLE_MAX; outdoor += 0.1f) {
+      maxError = max(maxError, fabsf((float) equitherm.getCurve(outdoor) - referenceCurve(kn, outdoor)));
+    }
+  }
+
+  equitherm.Kn = 2.5f;
+  printf("\n%-26s %10s %10s\n", "ns per value", "formula", "table");
+  printf("%-26s %10.2f %10.2f\n", "heating curve",
+    measure(frames, rounds, [](unsigned long a, unsigned long b) { return (unsigned long) referenceCurve(2.5f, (a % 700) / 10.0f - 40); }),
+    measure(frames, rounds, [&equitherm](unsigned long a, unsigned long b) { return (unsigned long) (float) equitherm.getCurve((a % 700) / 10.0f - 40); })
+  );
+  printf("Curve max error: %.4f\n", maxError);
+
+  // fixed point: the whole result with corrections against the float path
+  EquithermT<float> floatRegulator;
+  EquithermT<fixed16_t> fixedRegulator;
+  floatRegulator.setLimits(20, 90);
+  fixedRegulator.setLimits(20, 90);
+
+  float maxFixedError = 0;
+  for (float kn = 0.5f; kn <= 5; kn += 0.5f) {
+    for (float kk = 0; kk <= 4; kk += 1) {
+      for (float target = 16; target <= 26; target += 2.5f) {
+        for (float outdoor = EQUITHERM_TABLE_MIN - 5; outdoor <= EQUITHERM_TABLE_MAX + 5; outdoor += 0.1f) {
+          float indoor = target + sinf(outdoor) * 3;
+
+          floatRegulator.Kn = kn;
+          floatRegulator.Kk = kk;
+          floatRegulator.Kt = 2;
+          floatRegulator.targetTemp = target;
+          floatRegulator.indoorTemp = indoor;
+          floatRegulator.outdoorTemp = outdoor;
+
+          fixedRegulator.Kn = kn;
+          fixedRegulator.Kk = kk;
+          fixedRegulator.Kt = 2;
+          fixedRegulator.targetTemp = target;
+          fixedRegulator.indoorTemp = indoor;
+          fixedRegulator.outdoorTemp = outdoor;
+
+          maxFixedError = max(maxFixedError, fabsf(floatRegulator.getResult() - (float) fixedRegulator.getResult()));
+        }
+      }
+    }
+  }
+
+  // the integral types of the ESP8266 core must convert without an ambiguous overload:
+  // its round() macro returns long, the settings are byte and unsigned
+  long espRounded = 21;
+  EquithermT<fixed16_t> integralRegulator(2, 1, 0);
+  integralRegulator.setLimits((byte) 20, (byte) 90);
+  integralRegulator.targetTemp = (byte) 22;
+  integralRegulator.indoorTemp = espRounded;
+  integralRegulator.outdoorTemp = -5L;
+  integralRegulator.Kt = 2U;
+  floatRegulator.Kn = 2;
+  floatRegulator.Kk = 1;
+  floatRegulator.Kt = 2;
+  floatRegulator.targetTemp = 22;
+  floatRegulator.indoorTemp = 21;
+  floatRegulator.outdoorTemp = -5;
+  float integralError = fabsf(floatRegulator.getResult() - (float) integralRegulator.getResult());
+  printf("Fixed point integral inputs error: %.4f\n", integralError);
+
+  // inputs are converted once, as they are when the regulator gets them
+  std::vector<fixed16_t> fixedOutdoor(frames.size());
+  std::vector<float> floatOutdoor(frames.size());
+  for (size_t i = 0; i < frames.size(); i++) {
+    floatOutdoor[i] = (frames[i] % 800) / 10.0f - 45;
+    fixedOutdoor[i] = floatOutdoor[i];
+  }
+
+  floatRegulator.Kn = 2.5f;
+  fixedRegulator.Kn = 2.5f;
+  size_t value = 0;
+  printf("\n%-26s %10s %10s\n", "ns per value", "float", "Q16.16");
+  printf("%-26s %10.2f %10.2f\n", "getResult",
+    measure(frames, rounds, [&](unsigned long a, unsigned long b) {
+      floatRegulator.outdoorTemp = floatOutdoor[value++ % floatOutdoor.size()];
+      return (unsigned long) floatRegulator.getResult();
+    }),
+    measure(frames, rounds, [&](unsigned long a, unsigned long b) {
+      fixedRegulator.outdoorTemp = fixedOutdoor[value++ % fixedOutdoor.size()];
+      return (unsigned long) fixedRegulator.getResult().raw;
+    })
+  );
+  printf("Fixed point max error: %.4f\n", maxFixedError);
+
+  // the host has an FPU, so the saving on esp8266 shows as the float operations that are gone
+  EquithermT<CountingFloat> countingRegulator;
+  countingRegulator.Kn = 2.5f;
+  countingRegulator.Kk = 2;
+  countingRegulator.Kt = 2;
+  countingRegulator.targetTemp = 21;
+  countingRegulator.indoorTemp = 20.5f;
+  countingRegulator.getResult();
+
+  CountingFloat::operations = 0;
+  for (size_t i = 0; i < floatOutdoor.size(); i++) {
+    countingRegulator.outdoorTemp = floatOutdoor[i];
+    countingRegulator.getResult();
+  }
+  printf("Float operations per getResult: %.1f, Q16.16: 0\n", (double) CountingFloat::operations / floatOutdoor.size());
+
+  return mismatches > 0 || maxError > 0.01f || maxFixedError > 0.05f || integralError > 0.05f ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  TinyLogger::Level level = TinyLogger::Level::INFO;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) {
+      return runBenchmark();
+
+    } else if (strcmp(argv[i], "-v") == 0) {
+      level = TinyLogger::Level::VERBOSE;
+      verbose = true;
+
+    } else if (strcmp(argv[i], "-q") == 0) {
+      level = TinyLogger::Level::WARNING;
+
+    } else {
+      path = argv[i];
+    }
+  }
+
+  std::vector<ScenarioLine> scenario;
+  if (path == nullptr || !loadScenario(path, scenario)) {
+    fprintf(stderr, "Usage: %s <scenario> [-v] [-q] | --bench\n", argv[0]);
+    return 255;
+  }
+
+  Log.setLevel(level);
+  Log.addStream(&Serial);
+  settings.debug = verbose;
+
+  OpenTherm::bus() = &boiler;
+
+  SimulatorTask* tSimulator = new SimulatorTask(scenario);
+  Scheduler.start(tSimulator);
+
+  tOtTransport = new OpenThermTransportTask(true);
+  Scheduler.start(tOtTransport);
+
+  tOt = new OpenThermTask(true);
+  Scheduler.start(tOt);
+
+  tRegulator = new RegulatorTask(true, REGULATOR_WAKE_INTERVAL);
+  Scheduler.start(tRegulator);
+
+  auto started = std::chrono::steady_clock::now();
+  while (!tSimulator->isFinished()) {
+    if (!Scheduler.tick()) {
+      delay(1);
+    }
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+  printReport(elapsed.count());
+
+  if (tSimulator->getFailed() > 0) {
+    printf("\n%u expectation(s) failed\n", tSimulator->getFailed());
+  }
+
+  return min(tSimulator->getFailed(), 254U);
+}
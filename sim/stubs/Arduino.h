@@ -0,0 +1,218 @@
+#pragma once
+// Minimal Arduino API for the native (host) build.
+// Time is virtual: it only moves forward on delay()/yield() or when the simulator advances it.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define IRAM_ATTR
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define FPSTR(s) (s)
+#define __FlashStringHelper char
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define CHANGE 1
+
+#define DEC 10
+#define HEX 16
+
+#ifndef PI
+  #define PI 3.1415926535897932384626433832795
+#endif
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define sq(x) ((x) * (x))
+
+using std::min;
+using std::max;
+using std::abs;
+
+inline uint64_t nativeMicros = 0;
+
+inline unsigned long millis() {
+  return (unsigned long) (nativeMicros / 1000);
+}
+
+inline unsigned long micros() {
+  return (unsigned long) nativeMicros;
+}
+
+inline void delay(unsigned long ms) {
+  nativeMicros += (uint64_t) ms * 1000;
+}
+
+inline void delayMicroseconds(unsigned int us) {
+  nativeMicros += us;
+}
+
+// a bit of time passes, so busy-wait loops terminate
+inline void yield() {
+  nativeMicros += 100;
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return 0; }
+inline void attachInterrupt(uint8_t, void(*)(void), int) {}
+inline void detachInterrupt(uint8_t) {}
+inline uint8_t digitalPinToInterrupt(uint8_t pin) { return pin; }
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+inline long random(long min, long max) {
+  return max > min ? min + rand() % (max - min) : min;
+}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+
+    return n;
+  }
+
+  size_t write(const char* str) {
+    return str == nullptr ? 0 : write((const uint8_t*) str, strlen(str));
+  }
+
+  size_t printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    return write(buffer);
+  }
+
+  size_t print(const char* value) { return write(value); }
+  size_t print(const std::string& value) { return write(value.c_str()); }
+  size_t print(char value) { return write((uint8_t) value); }
+  size_t print(int value, int base = DEC) { return printf(base == HEX ? "%x" : "%d", value); }
+  size_t print(unsigned int value, int base = DEC) { return printf(base == HEX ? "%x" : "%u", value); }
+  size_t print(long value, int base = DEC) { return printf(base == HEX ? "%lx" : "%ld", value); }
+  size_t print(unsigned long value, int base = DEC) { return printf(base == HEX ? "%lx" : "%lu", value); }
+  size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+
+  size_t println() { return write("\r\n"); }
+
+  template <class T>
+  size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+
+  template <class T>
+  size_t println(T value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual void flush() {}
+};
+
+class StdoutStream : public Stream {
+public:
+  void begin(unsigned long) {}
+
+  size_t write(uint8_t c) override {
+    return fputc(c, stdout) == EOF ? 0 : 1;
+  }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    return fwrite(buffer, 1, size, stdout);
+  }
+
+  using Print::write;
+};
+
+inline StdoutStream Serial;
+
+class String : public std::string {
+public:
+  String() {}
+  String(const char* value) : std::string(value == nullptr ? "" : value) {}
+  String(const std::string& value) : std::string(value) {}
+  String(int value) : std::string(std::to_string(value)) {}
+  String(unsigned int value) : std::string(std::to_string(value)) {}
+  String(long value) : std::string(std::to_string(value)) {}
+  String(unsigned long value) : std::string(std::to_string(value)) {}
+  String(float value, unsigned int digits = 2) : std::string(format(value, digits)) {}
+  String(double value, unsigned int digits = 2) : std::string(format(value, digits)) {}
+
+  unsigned int length() const {
+    return size();
+  }
+
+  void concat(const char* value) {
+    append(value);
+  }
+
+  void concat(const String& value) {
+    append(value);
+  }
+
+  int toInt() const {
+    return atoi(c_str());
+  }
+
+  float toFloat() const {
+    return atof(c_str());
+  }
+
+protected:
+  static std::string format(double value, unsigned int digits) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return buffer;
+  }
+};
+
+struct EspClass {
+  void restart() {
+    exit(0);
+  }
+
+  uint32_t getFreeHeap() {
+    return 0;
+  }
+};
+
+inline EspClass ESP;
@@ -0,0 +1,56 @@
+#pragma once
+// EEManager replacement for the native build: the data is kept in RAM only.
+#include <Arduino.h>
+
+class EEManager {
+public:
+  template <class T>
+  EEManager(T& data, uint16_t timeout = 5000) : size(sizeof(T)) {}
+
+  uint8_t begin(uint16_t addr, uint8_t key) {
+    this->addr = addr;
+    return 1;
+  }
+
+  uint16_t blockSize() {
+    return size + 1;
+  }
+
+  uint16_t startAddr() {
+    return addr;
+  }
+
+  uint16_t endAddr() {
+    return addr + size;
+  }
+
+  uint16_t nextAddr() {
+    return addr + size + 1;
+  }
+
+  void setTimeout(uint16_t timeout) {}
+
+  void update() {
+    updates++;
+  }
+
+  void updateNow() {
+    updates++;
+  }
+
+  bool tick() {
+    return false;
+  }
+
+  void reset() {}
+
+  // number of update requests, useful to catch settings being rewritten in a loop
+  unsigned long getUpdates() {
+    return updates;
+  }
+
+protected:
+  uint16_t size;
+  uint16_t addr = 0;
+  unsigned long updates = 0;
+};
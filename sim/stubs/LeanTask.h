@@ -0,0 +1,7 @@
+#pragma once
+#include <Task.h>
+
+class LeanTask : public Task {
+public:
+  LeanTask(bool _enabled = false, unsigned long _interval = 0) : Task(_enabled, _interval) {}
+};
@@ -0,0 +1,429 @@
+#pragma once
+// Host implementation of the ihormelnyk OpenTherm Library API (1.1.x).
+// Frames are not bit-banged, they are handed to an OpenThermBus (e.g. VirtualBoiler)
+// and the response is delivered after the latency reported by the bus.
+// An instance in the slave mode gets its requests from an OpenThermMaster (e.g. VirtualThermostat).
+#include <Arduino.h>
+
+enum class OpenThermResponseStatus : byte {
+  NONE,
+  SUCCESS,
+  INVALID,
+  TIMEOUT
+};
+
+enum class OpenThermMessageType : byte {
+  READ_DATA = 0,
+  READ = READ_DATA,
+  WRITE_DATA = 1,
+  WRITE = WRITE_DATA,
+  INVALID_DATA = 2,
+  RESERVED = 3,
+  READ_ACK = 4,
+  WRITE_ACK = 5,
+  DATA_INVALID = 6,
+  UNKNOWN_DATA_ID = 7
+};
+
+typedef OpenThermMessageType OpenThermRequestType;
+
+enum class OpenThermMessageID : byte {
+  Status,
+  TSet,
+  MConfigMMemberIDcode,
+  SConfigSMemberIDcode,
+  Command,
+  ASFflags,
+  RBPflags,
+  CoolingControl,
+  TsetCH2,
+  TrOverride,
+  TSP,
+  TSPindexTSPvalue,
+  FHBsize,
+  FHBindexFHBvalue,
+  MaxRelModLevelSetting,
+  MaxCapacityMinModLevel,
+  TrSet,
+  RelModLevel,
+  CHPressure,
+  DHWFlowRate,
+  DayTime,
+  Date,
+  Year,
+  TrSetCH2,
+  Tr,
+  Tboiler,
+  Tdhw,
+  Toutside,
+  Tret,
+  Tstorage,
+  Tcollector,
+  TflowCH2,
+  Tdhw2,
+  Texhaust,
+  TdhwSetUBTdhwSetLB = 48,
+  MaxTSetUBMaxTSetLB,
+  HcratioUBHcratioLB,
+  TdhwSet = 56,
+  MaxTSet,
+  Hcratio,
+  RemoteOverrideFunction = 100,
+  OEMDiagnosticCode = 115,
+  BurnerStarts,
+  CHPumpStarts,
+  DHWPumpValveStarts,
+  DHWBurnerStarts,
+  BurnerOperationHours,
+  CHPumpOperationHours,
+  DHWPumpValveOperationHours,
+  DHWBurnerOperationHours,
+  OpenThermVersionMaster,
+  OpenThermVersionSlave,
+  MasterVersion,
+  SlaveVersion
+};
+
+enum class OpenThermStatus : byte {
+  NOT_INITIALIZED,
+  READY,
+  DELAY,
+  REQUEST_SENDING,
+  RESPONSE_WAITING,
+  RESPONSE_START_BIT,
+  RESPONSE_RECEIVING,
+  RESPONSE_READY,
+  RESPONSE_INVALID
+};
+
+// 1 start bit + 32 data bits + 1 stop bit, 1 ms each
+#define OT_NATIVE_FRAME_TIME 34
+
+class OpenThermBus {
+public:
+  virtual ~OpenThermBus() {}
+  // false if the slave does not answer, latency - time between the request and the response frames, ms
+  virtual bool transfer(unsigned long request, unsigned long& response, unsigned long& latency) = 0;
+};
+
+class OpenThermMaster {
+public:
+  virtual ~OpenThermMaster() {}
+  virtual void handleResponse(unsigned long response) = 0;
+};
+
+class OpenTherm {
+public:
+  volatile OpenThermStatus status = OpenThermStatus::NOT_INITIALIZED;
+
+  OpenTherm(int inPin = 4, int outPin = 5, bool isSlave = false) : isSlave(isSlave) {}
+
+  static OpenThermBus*& bus() {
+    static OpenThermBus* instance = nullptr;
+    return instance;
+  }
+
+  // the instance in the slave mode and the master talking to it
+  static OpenTherm*& slave() {
+    static OpenTherm* instance = nullptr;
+    return instance;
+  }
+
+  static OpenThermMaster*& master() {
+    static OpenThermMaster* instance = nullptr;
+    return instance;
+  }
+
+  // called by the master, the request is received after the frame time
+  void receiveRequest(unsigned long request) {
+    pendingRequest = request;
+    requestAt = micros() + OT_NATIVE_FRAME_TIME * 1000UL;
+    hasPendingRequest = true;
+  }
+
+  void begin(void(*handleInterruptCallback)(void)) {
+    begin(handleInterruptCallback, nullptr);
+  }
+
+  void begin(void(*handleInterruptCallback)(void), void(*processResponseCallback)(unsigned long, OpenThermResponseStatus)) {
+    this->processResponseCallback = processResponseCallback;
+    status = OpenThermStatus::READY;
+
+    if (isSlave) {
+      slave() = this;
+    }
+  }
+
+  void end() {
+    status = OpenThermStatus::NOT_INITIALIZED;
+  }
+
+  bool isReady() {
+    return status == OpenThermStatus::READY;
+  }
+
+  unsigned long sendRequest(unsigned long request) {
+    if (!sendRequestAync(request)) {
+      return 0;
+    }
+
+    while (!isReady()) {
+      process();
+      yield();
+    }
+
+    return response;
+  }
+
+  // blocks for the frame time as the bit-banging does
+  bool sendResponse(unsigned long request) {
+    if (!isSlave || status != OpenThermStatus::READY) {
+      return false;
+    }
+
+    ::delay(OT_NATIVE_FRAME_TIME);
+    if (master() != nullptr) {
+      master()->handleResponse(request);
+    }
+
+    return true;
+  }
+
+  bool sendRequestAync(unsigned long request) {
+    if (status != OpenThermStatus::READY) {
+      return false;
+    }
+
+    responseStatus = OpenThermResponseStatus::NONE;
+    response = 0;
+    responseTimestamp = micros();
+
+    unsigned long _response = 0;
+    unsigned long latency = 0;
+    if (bus() != nullptr && bus()->transfer(request, _response, latency)) {
+      pendingResponse = _response;
+      responseAt = micros() + (OT_NATIVE_FRAME_TIME * 2 + latency) * 1000UL;
+      hasPendingResponse = true;
+
+    } else {
+      hasPendingResponse = false;
+    }
+
+    status = OpenThermStatus::RESPONSE_WAITING;
+    return true;
+  }
+
+  void handleInterrupt() {}
+
+  void process() {
+    if (isSlave) {
+      if (hasPendingRequest && (long) (micros() - requestAt) >= 0) {
+        hasPendingRequest = false;
+        response = pendingRequest;
+        responseStatus = isValidRequest(response) ? OpenThermResponseStatus::SUCCESS : OpenThermResponseStatus::INVALID;
+
+        if (processResponseCallback != nullptr) {
+          processResponseCallback(response, responseStatus);
+        }
+      }
+
+      return;
+    }
+
+    OpenThermStatus st = status;
+    if (st == OpenThermStatus::READY || st == OpenThermStatus::NOT_INITIALIZED) {
+      return;
+    }
+
+    unsigned long now = micros();
+    if (st == OpenThermStatus::RESPONSE_WAITING && hasPendingResponse && (long) (now - responseAt) >= 0) {
+      hasPendingResponse = false;
+      response = pendingResponse;
+      responseTimestamp = now;
+      status = OpenThermStatus::DELAY;
+      responseStatus = isValidResponse(response) ? OpenThermResponseStatus::SUCCESS : OpenThermResponseStatus::INVALID;
+
+      if (processResponseCallback != nullptr) {
+        processResponseCallback(response, responseStatus);
+      }
+
+    } else if (st == OpenThermStatus::RESPONSE_WAITING && now - responseTimestamp > 1000000) {
+      status = OpenThermStatus::READY;
+      responseStatus = OpenThermResponseStatus::TIMEOUT;
+
+      if (processResponseCallback != nullptr) {
+        processResponseCallback(response, responseStatus);
+      }
+
+    } else if (st == OpenThermStatus::DELAY && now - responseTimestamp > 100000) {
+      status = OpenThermStatus::READY;
+    }
+  }
+
+  unsigned long getLastResponse() {
+    return response;
+  }
+
+  OpenThermResponseStatus getLastResponseStatus() {
+    return responseStatus;
+  }
+
+  static bool parity(unsigned long frame) {
+    byte p = 0;
+    while (frame > 0) {
+      if (frame & 1) {
+        p++;
+      }
+
+      frame >>= 1;
+    }
+
+    return p & 1;
+  }
+
+  static unsigned long buildRequest(OpenThermMessageType type, OpenThermMessageID id, unsigned int data) {
+    unsigned long request = data;
+    if (type == OpenThermMessageType::WRITE_DATA) {
+      request |= 1UL << 28;
+    }
+
+    request |= ((unsigned long) id) << 16;
+    if (parity(request)) {
+      request |= 1UL << 31;
+    }
+
+    return request;
+  }
+
+  static unsigned long buildResponse(OpenThermMessageType type, OpenThermMessageID id, unsigned int data) {
+    unsigned long response = data;
+    response |= ((unsigned long) type) << 28;
+    response |= ((unsigned long) id) << 16;
+    if (parity(response)) {
+      response |= 1UL << 31;
+    }
+
+    return response;
+  }
+
+  static OpenThermMessageType getMessageType(unsigned long message) {
+    return (OpenThermMessageType) ((message >> 28) & 7);
+  }
+
+  static OpenThermMessageID getDataID(unsigned long frame) {
+    return (OpenThermMessageID) ((frame >> 16) & 0xFF);
+  }
+
+  bool isValidRequest(unsigned long request) {
+    if (parity(request)) {
+      return false;
+    }
+
+    byte msgType = (request >> 28) & 7;
+    return msgType == (byte) OpenThermMessageType::READ_DATA || msgType == (byte) OpenThermMessageType::WRITE_DATA;
+  }
+
+  bool isValidResponse(unsigned long response) {
+    if (parity(response)) {
+      return false;
+    }
+
+    byte msgType = (response >> 28) & 7;
+    return msgType == (byte) OpenThermMessageType::READ_ACK || msgType == (byte) OpenThermMessageType::WRITE_ACK;
+  }
+
+  static const char* statusToString(OpenThermResponseStatus status) {
+    switch (status) {
+      case OpenThermResponseStatus::NONE: return "NONE";
+      case OpenThermResponseStatus::SUCCESS: return "SUCCESS";
+      case OpenThermResponseStatus::INVALID: return "INVALID";
+      case OpenThermResponseStatus::TIMEOUT: return "TIMEOUT";
+      default: return "UNKNOWN";
+    }
+  }
+
+  static const char* messageTypeToString(OpenThermMessageType messageType) {
+    switch (messageType) {
+      case OpenThermMessageType::READ_DATA: return "READ_DATA";
+      case OpenThermMessageType::WRITE_DATA: return "WRITE_DATA";
+      case OpenThermMessageType::INVALID_DATA: return "INVALID_DATA";
+      case OpenThermMessageType::RESERVED: return "RESERVED";
+      case OpenThermMessageType::READ_ACK: return "READ_ACK";
+      case OpenThermMessageType::WRITE_ACK: return "WRITE_ACK";
+      case OpenThermMessageType::DATA_INVALID: return "DATA_INVALID";
+      case OpenThermMessageType::UNKNOWN_DATA_ID: return "UNKNOWN_DATA_ID";
+      default: return "UNKNOWN";
+    }
+  }
+
+  unsigned long buildSetBoilerStatusRequest(bool enableCentralHeating, bool enableHotWater = false, bool enableCooling = false, bool enableOutsideTemperatureCompensation = false, bool enableCentralHeating2 = false) {
+    unsigned int data = enableCentralHeating | (enableHotWater << 1) | (enableCooling << 2) | (enableOutsideTemperatureCompensation << 3) | (enableCentralHeating2 << 4);
+    data <<= 8;
+    return buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Status, data);
+  }
+
+  unsigned long buildSetBoilerTemperatureRequest(float temperature) {
+    return buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::TSet, temperatureToData(temperature));
+  }
+
+  unsigned long buildGetBoilerTemperatureRequest() {
+    return buildRequest(OpenThermMessageType::READ_DATA, OpenThermMessageID::Tboiler, 0);
+  }
+
+  bool isFault(unsigned long response) {
+    return response & 0x1;
+  }
+
+  bool isCentralHeatingActive(unsigned long response) {
+    return response & 0x2;
+  }
+
+  bool isHotWaterActive(unsigned long response) {
+    return response & 0x4;
+  }
+
+  bool isFlameOn(unsigned long response) {
+    return response & 0x8;
+  }
+
+  bool isCoolingActive(unsigned long response) {
+    return response & 0x10;
+  }
+
+  bool isDiagnostic(unsigned long response) {
+    return response & 0x40;
+  }
+
+  uint16_t getUInt(const unsigned long response) const {
+    return response & 0xFFFF;
+  }
+
+  float getFloat(const unsigned long response) const {
+    return ((int16_t) getUInt(response)) / 256.0f;
+  }
+
+  unsigned int temperatureToData(float temperature) {
+    if (temperature < 0) {
+      temperature = 0;
+    }
+
+    if (temperature > 100) {
+      temperature = 100;
+    }
+
+    return (unsigned int) (temperature * 256);
+  }
+
+protected:
+  bool isSlave;
+  unsigned long response = 0;
+  OpenThermResponseStatus responseStatus = OpenThermResponseStatus::NONE;
+  unsigned long responseTimestamp = 0;
+  unsigned long pendingResponse = 0;
+  unsigned long responseAt = 0;
+  bool hasPendingResponse = false;
+  unsigned long pendingRequest = 0;
+  unsigned long requestAt = 0;
+  bool hasPendingRequest = false;
+  void(*processResponseCallback)(unsigned long, OpenThermResponseStatus) = nullptr;
+};
@@ -0,0 +1,112 @@
+#pragma once
+// Single threaded replacement of ESP32Scheduler/ESP8266Scheduler.
+// Every task runs as a coroutine on its own stack, like the ESP8266 scheduler does:
+// a blocking delay() suspends only the calling task, the virtual time moves when all tasks wait.
+#include <Arduino.h>
+#include <Task.h>
+#include <ucontext.h>
+#include <chrono>
+#include <vector>
+
+#define SIM_TASK_STACK_SIZE (256 * 1024)
+
+class SchedulerClass {
+public:
+  struct TaskStats {
+    const char* name;
+    unsigned long calls;
+    double totalUs;
+    double maxUs;
+  };
+
+  SchedulerClass() {
+    Task::waitHandler = [](Task* task, unsigned long ms) {
+      instance->wait(task, ms);
+    };
+    instance = this;
+  }
+
+  void start(Task* task) {
+    tasks.push_back(task);
+    stats.push_back({task->getTaskName(), 0, 0, 0});
+  }
+
+  // resumes every task which is ready, returns false if nothing was ready
+  bool tick() {
+    bool result = false;
+
+    for (size_t i = 0; i < tasks.size(); i++) {
+      Task* task = tasks[i];
+      if (!task->enabled || (long) (millis() - task->wakeTime) < 0) {
+        continue;
+      }
+
+      if (task->stack.empty()) {
+        task->stack.resize(SIM_TASK_STACK_SIZE);
+        getcontext(&task->context);
+        task->context.uc_stack.ss_sp = task->stack.data();
+        task->context.uc_stack.ss_size = task->stack.size();
+        task->context.uc_link = nullptr;
+        makecontext(&task->context, run, 0);
+      }
+
+      // wall time of the task until it blocks again, the virtual delays cost nothing
+      current = i;
+      auto started = std::chrono::steady_clock::now();
+      swapcontext(&context, &task->context);
+      std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - started;
+      task->loopUs += elapsed.count();
+
+      result = true;
+    }
+
+    return result;
+  }
+
+  const std::vector<TaskStats>& getStats() {
+    return stats;
+  }
+
+protected:
+  static inline SchedulerClass* instance = nullptr;
+  std::vector<Task*> tasks;
+  std::vector<TaskStats> stats;
+  ucontext_t context;
+  size_t current = 0;
+
+  void wait(Task* task, unsigned long ms) {
+    task->wakeTime = millis() + ms;
+    swapcontext(&task->context, &context);
+  }
+
+  void finishLoop(size_t index) {
+    Task* task = tasks[index];
+
+    stats[index].calls++;
+    stats[index].totalUs += task->loopUs;
+    stats[index].maxUs = max(stats[index].maxUs, task->loopUs);
+    task->loopUs = 0;
+  }
+
+  static void run() {
+    size_t index = instance->current;
+    Task* task = instance->tasks[index];
+    task->setup();
+
+    for (;;) {
+      unsigned long lastRun = millis();
+      task->loop();
+      instance->finishLoop(index);
+
+      // the interval counts from the start of the previous loop
+      if (task->interval > 0 && millis() - lastRun < task->interval) {
+        instance->wait(task, task->interval - (millis() - lastRun));
+
+      } else {
+        instance->wait(task, 0);
+      }
+    }
+  }
+};
+
+inline SchedulerClass Scheduler;
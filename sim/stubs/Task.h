@@ -0,0 +1,65 @@
+#pragma once
+// Cooperative Task for the native build, see Scheduler.h
+#include <Arduino.h>
+#include <ucontext.h>
+#include <vector>
+
+class Task {
+  friend class SchedulerClass;
+
+public:
+  Task(bool _enabled = false, unsigned long _interval = 0) : enabled(_enabled), interval(_interval) {}
+  virtual ~Task() {}
+
+  bool isEnabled() {
+    return enabled;
+  }
+
+  void enable() {
+    enabled = true;
+  }
+
+  void disable() {
+    enabled = false;
+  }
+
+  void setInterval(unsigned long value) {
+    interval = value;
+  }
+
+protected:
+  bool enabled;
+  unsigned long interval;
+  unsigned long wakeTime = 0;
+  std::vector<char> stack;
+  ucontext_t context;
+  double loopUs = 0;
+
+  // set by the scheduler: suspends the task until the virtual time reaches the end of the delay
+  static inline void (*waitHandler)(Task*, unsigned long) = nullptr;
+
+  virtual void setup() {}
+  virtual void loop() {}
+
+  virtual const char* getTaskName() {
+    return "Task";
+  }
+
+  virtual int getTaskCore() {
+    return 0;
+  }
+
+  // Blocks the task, the other tasks run meanwhile
+  void delay(unsigned long ms) {
+    if (waitHandler != nullptr) {
+      waitHandler(this, ms);
+
+    } else {
+      ::delay(ms);
+    }
+  }
+
+  void yield() {
+    ::yield();
+  }
+};
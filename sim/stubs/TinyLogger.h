@@ -0,0 +1,97 @@
+#pragma once
+// TinyLogger compatible logger for the native build, messages are prefixed with the virtual time.
+#include <Arduino.h>
+#include <vector>
+
+class TinyLogger : public Print {
+public:
+  enum class Level : byte {
+    SILENT,
+    FATAL,
+    ERROR,
+    WARNING,
+    INFO,
+    NOTICE,
+    TRACE,
+    VERBOSE
+  };
+
+  void setLevel(Level level) {
+    this->level = level;
+  }
+
+  Level getLevel() {
+    return level;
+  }
+
+  void addStream(Stream* stream) {
+    streams.push_back(stream);
+  }
+
+  std::vector<Stream*> getStreams() {
+    return streams;
+  }
+
+  size_t write(uint8_t c) override {
+    for (Stream* stream : streams) {
+      stream->write(c);
+    }
+
+    return 1;
+  }
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    for (Stream* stream : streams) {
+      stream->write(buffer, size);
+    }
+
+    return size;
+  }
+
+  using Print::write;
+
+  #define TL_NATIVE_METHOD(name, _level, newLine) \
+    void name(const char* service, const char* format, ...) { \
+      va_list args; \
+      va_start(args, format); \
+      log(Level::_level, #_level, service, format, args, newLine); \
+      va_end(args); \
+    }
+
+  TL_NATIVE_METHOD(sfatalln, FATAL, true)
+  TL_NATIVE_METHOD(serrorln, ERROR, true)
+  TL_NATIVE_METHOD(serror, ERROR, false)
+  TL_NATIVE_METHOD(swarningln, WARNING, true)
+  TL_NATIVE_METHOD(swarning, WARNING, false)
+  TL_NATIVE_METHOD(sinfoln, INFO, true)
+  TL_NATIVE_METHOD(sinfo, INFO, false)
+  TL_NATIVE_METHOD(snoticeln, NOTICE, true)
+  TL_NATIVE_METHOD(snotice, NOTICE, false)
+  TL_NATIVE_METHOD(straceln, TRACE, true)
+  TL_NATIVE_METHOD(strace, TRACE, false)
+  TL_NATIVE_METHOD(sverboseln, VERBOSE, true)
+  TL_NATIVE_METHOD(sverbose, VERBOSE, false)
+
+  #undef TL_NATIVE_METHOD
+
+protected:
+  Level level = Level::VERBOSE;
+  std::vector<Stream*> streams;
+
+  void log(Level _level, const char* levelName, const char* service, const char* format, va_list args, bool newLine) {
+    if (_level > level || streams.empty()) {
+      return;
+    }
+
+    char buffer[512];
+    vsnprintf(buffer, sizeof(buffer), format, args);
+
+    unsigned long ts = millis();
+    printf("[%02lu:%02lu:%02lu.%03lu] %c %s: ", ts / 3600000, ts / 60000 % 60, ts / 1000 % 60, ts % 1000, levelName[0], service);
+    print(buffer);
+
+    if (newLine) {
+      println();
+    }
+  }
+};
@@ -257,6 +257,50 @@ public:
     return publish(getTopic("number", "heating_hysteresis").c_str(), doc);
   }
 
+  bool publishNumberHeatingSetpointStep(bool enabledByDefault = true) {
+    StaticJsonDocument<1536> doc;
+    doc[FPSTR(HA_ENABLED_BY_DEFAULT)] = enabledByDefault;
+    doc[FPSTR(HA_UNIQUE_ID)] = devicePrefix + F("_heating_setpoint_step");
+    doc[FPSTR(HA_OBJECT_ID)] = devicePrefix + F("_heating_setpoint_step");
+    doc[FPSTR(HA_ENTITY_CATEGORY)] = F("config");
+    doc[FPSTR(HA_DEVICE_CLASS)] = F("temperature");
+    doc[FPSTR(HA_UNIT_OF_MEASUREMENT)] = F("°C");
+    doc[FPSTR(HA_NAME)] = F("Heating setpoint step");
+    doc[FPSTR(HA_ICON)] = F("mdi:stairs");
+    doc[FPSTR(HA_STATE_TOPIC)] = devicePrefix + F("/settings");
+    doc[FPSTR(HA_VALUE_TEMPLATE)] = F("{{ value_json.heating.setpointStep|float(0)|round(2) }}");
+    doc[FPSTR(HA_COMMAND_TOPIC)] = devicePrefix + F("/settings/set");
+    doc[FPSTR(HA_COMMAND_TEMPLATE)] = F("{\"heating\": {\"setpointStep\" : {{ value }}}}");
+    doc[FPSTR(HA_MIN)] = 0;
+    doc[FPSTR(HA_MAX)] = 1;
+    doc[FPSTR(HA_STEP)] = 0.05;
+    doc[FPSTR(HA_MODE)] = "box";
+
+    return publish(getTopic("number", "heating_setpoint_step").c_str(), doc);
+  }
+
+  bool publishNumberHeatingSetpointDeadband(bool enabledByDefault = true) {
+    StaticJsonDocument<1536> doc;
+    doc[FPSTR(HA_ENABLED_BY_DEFAULT)] = enabledByDefault;
+    doc[FPSTR(HA_UNIQUE_ID)] = devicePrefix + F("_heating_setpoint_deadband");
+    doc[FPSTR(HA_OBJECT_ID)] = devicePrefix + F("_heating_setpoint_deadband");
+    doc[FPSTR(HA_ENTITY_CATEGORY)] = F("config");
+    doc[FPSTR(HA_DEVICE_CLASS)] = F("temperature");
+    doc[FPSTR(HA_UNIT_OF_MEASUREMENT)] = F("°C");
+    doc[FPSTR(HA_NAME)] = F("Heating setpoint deadband");
+    doc[FPSTR(HA_ICON)] = F("mdi:arrow-expand-vertical");
+    doc[FPSTR(HA_STATE_TOPIC)] = devicePrefix + F("/settings");
+    doc[FPSTR(HA_VALUE_TEMPLATE)] = F("{{ value_json.heating.setpointDeadband|float(0)|round(2) }}");
+    doc[FPSTR(HA_COMMAND_TOPIC)] = devicePrefix + F("/settings/set");
+    doc[FPSTR(HA_COMMAND_TEMPLATE)] = F("{\"heating\": {\"setpointDeadband\" : {{ value }}}}");
+    doc[FPSTR(HA_MIN)] = 0;
+    doc[FPSTR(HA_MAX)] = 5;
+    doc[FPSTR(HA_STEP)] = 0.05;
+    doc[FPSTR(HA_MODE)] = "box";
+
+    return publish(getTopic("number", "heating_setpoint_deadband").c_str(), doc);
+  }
+
   bool publishSensorHeatingSetpoint(bool enabledByDefault = true) {
     StaticJsonDocument<1536> doc;
     doc[FPSTR(HA_AVAILABILITY)][FPSTR(HA_TOPIC)] = devicePrefix + F("/status");
@@ -270,7 +314,7 @@ public:
     doc[FPSTR(HA_NAME)] = F("Heating setpoint");
     doc[FPSTR(HA_ICON)] = F("mdi:coolant-temperature");
     doc[FPSTR(HA_STATE_TOPIC)] = devicePrefix + F("/state");
-    doc[FPSTR(HA_VALUE_TEMPLATE)] = F("{{ value_json.parameters.heatingSetpoint|int(0) }}");
+    doc[FPSTR(HA_VALUE_TEMPLATE)] = F("{{ value_json.parameters.heatingSetpoint|float(0)|round(1) }}");
 
     return publish(getTopic("sensor", "heating_setpoint").c_str(), doc);
   }
@@ -5,8 +5,10 @@ extern Settings settings;
 
 extern MqttTask* tMqtt;
 extern SensorsTask* tSensors;
+extern OpenThermTransportTask* tOtTransport;
 extern OpenThermTask* tOt;
 extern EEManager eeSettings;
+extern EEManager eeProfile;
 extern TinyLogger Log;
 #if USE_TELNET
   extern ESPTelnetStream TelnetStream;
@@ -24,6 +26,10 @@ protected:
   unsigned int heapSize = 0;
   unsigned int minFreeHeapSize = 0;
   unsigned long restartSignalTime = 0;
+  unsigned long otRxSuccess = 0;
+  unsigned long otRxErrors = 0;
+  unsigned long otRxLedTime = 0;
+  unsigned int otRxLedDuration = 0;
 
   const char* getTaskName() {
     return "Main";
@@ -39,6 +45,11 @@ protected:
       digitalWrite(LED_STATUS_PIN, false);
     #endif
 
+    #ifdef LED_OT_RX_PIN
+      pinMode(LED_OT_RX_PIN, OUTPUT);
+      digitalWrite(LED_OT_RX_PIN, false);
+    #endif
+
     #if defined(ESP32)
       heapSize = ESP.getHeapSize();
     #elif defined(ESP8266)
@@ -54,6 +65,10 @@ protected:
       Log.sinfoln("MAIN", PSTR("Settings updated (EEPROM)"));
     }
 
+    if (eeProfile.tick()) {
+      Log.sinfoln("MAIN", PSTR("Boiler profile updated (EEPROM)"));
+    }
+
     #if USE_TELNET
       TelnetStream.loop();
     #endif
@@ -61,6 +76,7 @@ protected:
     if (vars.actions.restart) {
       Log.sinfoln("MAIN", PSTR("Restart signal received. Restart after 10 sec."));
       eeSettings.updateNow();
+      eeProfile.updateNow();
       restartSignalTime = millis();
       vars.actions.restart = false;
     }
@@ -89,12 +105,14 @@ protected:
 
         if (millis() - firstFailConnect > EMERGENCY_TIME_TRESHOLD) {
           vars.states.emergency = true;
+          vars.actions.updateSetpoint = true;
           Log.sinfoln("MAIN", PSTR("Emergency mode enabled"));
         }
       }
     }
 
     if (!tOt->isEnabled() && settings.opentherm.inPin > 0 && settings.opentherm.outPin > 0 && settings.opentherm.inPin != settings.opentherm.outPin) {
+      tOtTransport->enable();
       tOt->enable();
     }
 
@@ -102,6 +120,10 @@ protected:
       ledStatus(LED_STATUS_PIN);
       yield();
     #endif
+
+    #ifdef LED_OT_RX_PIN
+      ledOtRx(LED_OT_RX_PIN);
+    #endif
     heap();
 
     // anti memory leak
@@ -200,4 +222,25 @@ protected:
 
     this->blinker->tick();
   }
-};
\ No newline at end of file
+
+  // Short flash for every response, long one for an error/timeout.
+  // The flash rate follows the bus load, a mostly lit led means a lot of errors.
+  void ledOtRx(uint8_t ledPin) {
+    unsigned long success = otActivity.success;
+    unsigned long errors = otActivity.errors;
+
+    if (errors != otRxErrors || success != otRxSuccess) {
+      otRxLedDuration = errors != otRxErrors ? 250 : 20;
+      otRxLedTime = millis();
+      otRxSuccess = success;
+      otRxErrors = errors;
+
+      digitalWrite(ledPin, true);
+
+    } else if (otRxLedDuration > 0 && millis() - otRxLedTime >= otRxLedDuration) {
+      otRxLedDuration = 0;
+
+      digitalWrite(ledPin, false);
+    }
+  }
+};
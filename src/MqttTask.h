@@ -2,6 +2,13 @@
 #include <WiFiClient.h>
 #include <PubSubClient.h>
 #include "HaHelper.h"
+#include <CustomOpenTherm.h>
+#include <OpenThermTransport.h>
+#include <OpenThermCapabilities.h>
+#include <OpenThermStats.h>
+#include <OpenThermTrace.h>
+#include <OpenThermRawBatch.h>
+#include <Equitherm.h>
 
 WiFiClient espClient;
 PubSubClient client(espClient);
@@ -13,6 +20,13 @@ extern Variables vars;
 extern Settings settings;
 extern EEManager eeSettings;
 extern TinyLogger Log;
+extern CustomOpenTherm* ot;
+extern OpenThermTransport otTransport;
+extern OpenThermCapabilities otCapabilities;
+extern OpenThermStats otStats;
+extern OpenThermTrace otTrace;
+extern OpenThermRawBatch otRawBatch;
+extern Equitherm etRegulator;
 
 
 class MqttTask : public Task {
@@ -22,6 +36,7 @@ public:
 protected:
   unsigned long lastReconnectAttempt = 0;
   unsigned long firstFailConnect = 0;
+  CustomOpenTherm::Request actionRequest;
 
   const char* getTaskName() {
     return "Mqtt";
@@ -55,6 +70,7 @@ protected:
 
         client.subscribe(getTopicPath("settings/set").c_str());
         client.subscribe(getTopicPath("state/set").c_str());
+        client.subscribe(getTopicPath("raw/set").c_str());
         publishHaEntities();
         publishNonStaticHaEntities(true);
 
@@ -71,6 +87,7 @@ protected:
 
           if (millis() - firstFailConnect > EMERGENCY_TIME_TRESHOLD) {
             vars.states.emergency = true;
+            vars.actions.updateSetpoint = true;
             Log.sinfoln("MQTT", PSTR("Emergency mode enabled"));
           }
         }
@@ -83,6 +100,7 @@ protected:
     if (client.connected()) {
       if (vars.states.emergency) {
         vars.states.emergency = false;
+        vars.actions.updateSetpoint = true;
 
         Log.sinfoln("MQTT", PSTR("Emergency mode disabled"));
       }
@@ -90,9 +108,60 @@ protected:
       client.loop();
       bool published = publishNonStaticHaEntities();
       publish(published);
+
+      if (vars.actions.publishStats) {
+        publishStats();
+        vars.actions.publishStats = false;
+      }
+
+      if (vars.actions.dumpTrace) {
+        dumpTrace(vars.actions.dumpTrace);
+        vars.actions.dumpTrace = 0;
+      }
+
+      // the frames are sent by the OpenThermTask
+      if (otRawBatch.isFinished()) {
+        publishRawFrames(getTopicPath("raw").c_str());
+        otRawBatch.clear();
+      }
+    }
+
+    // boiler commands go through the transport queue, the result is logged by the transport task
+    if (ot != nullptr && (actionRequest.state == CustomOpenTherm::RequestState::IDLE || actionRequest.isDone())) {
+      if (vars.actions.resetFault) {
+        if (vars.states.fault) {
+          sendAction(1, "Boiler fault reset");
+        }
+
+        vars.actions.resetFault = false;
+
+      } else if (vars.actions.resetDiagnostic) {
+        if (vars.states.diagnostic) {
+          sendAction(10, "Boiler diagnostic reset");
+        }
+
+        vars.actions.resetDiagnostic = false;
+      }
     }
   }
 
+  void sendAction(byte command, const char* name) {
+    actionRequest.request = ot->buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::Command, command << 8);
+    actionRequest.attempts = 5;
+    actionRequest.completeArg = (void*) name;
+    actionRequest.completeCallback = [](CustomOpenTherm::Request* request, void* name) {
+      if (ot->isValidResponse(request->request, request->response)) {
+        Log.sinfoln("OT", PSTR("%s successfully"), (const char*) name);
+
+      } else {
+        Log.serrorln("OT", PSTR("%s failed"), (const char*) name);
+      }
+    };
+
+    if (!otTransport.submit(OT_TRANSPORT_ACTIONS, actionRequest)) {
+      Log.serrorln("OT", PSTR("%s failed: queue is full"), name);
+    }
+  }
 
   static bool updateSettings(JsonDocument& doc) {
     bool flag = false;
@@ -147,6 +216,20 @@ protected:
       }
     }
 
+    if (!doc["heating"]["setpointStep"].isNull() && doc["heating"]["setpointStep"].is<float>()) {
+      if (doc["heating"]["setpointStep"].as<float>() >= 0 && doc["heating"]["setpointStep"].as<float>() <= 1) {
+        settings.heating.setpointStep = round(doc["heating"]["setpointStep"].as<float>() * 100) / 100;
+        flag = true;
+      }
+    }
+
+    if (!doc["heating"]["setpointDeadband"].isNull() && doc["heating"]["setpointDeadband"].is<float>()) {
+      if (doc["heating"]["setpointDeadband"].as<float>() >= 0 && doc["heating"]["setpointDeadband"].as<float>() <= 5) {
+        settings.heating.setpointDeadband = round(doc["heating"]["setpointDeadband"].as<float>() * 100) / 100;
+        flag = true;
+      }
+    }
+
     if (!doc["heating"]["maxModulation"].isNull() && doc["heating"]["maxModulation"].is<unsigned char>()) {
       if (doc["heating"]["maxModulation"].as<unsigned char>() > 0 && doc["heating"]["maxModulation"].as<unsigned char>() <= 100) {
         settings.heating.maxModulation = doc["heating"]["maxModulation"].as<unsigned char>();
@@ -298,6 +381,7 @@ protected:
 
     if (flag) {
       eeSettings.update();
+      vars.actions.updateSetpoint = true;
       publish(true);
 
       return true;
@@ -351,7 +435,21 @@ protected:
       vars.actions.resetDiagnostic = true;
     }
 
+    if (!doc["actions"]["publishStats"].isNull() && doc["actions"]["publishStats"].is<bool>() && doc["actions"]["publishStats"].as<bool>()) {
+      vars.actions.publishStats = true;
+    }
+
+    if (!doc["actions"]["dumpTrace"].isNull() && doc["actions"]["dumpTrace"].is<const char*>()) {
+      if (strcmp(doc["actions"]["dumpTrace"].as<const char*>(), "binary") == 0) {
+        vars.actions.dumpTrace = 1;
+
+      } else if (strcmp(doc["actions"]["dumpTrace"].as<const char*>(), "text") == 0) {
+        vars.actions.dumpTrace = 2;
+      }
+    }
+
     if (flag) {
+      vars.actions.updateSetpoint = true;
       publish(true);
 
       return true;
@@ -363,6 +461,8 @@ protected:
   static void publish(bool force = false) {
     static unsigned int prevPubVars = 0;
     static unsigned int prevPubSettings = 0;
+    static unsigned int prevPubTelemetry = 0;
+    static unsigned int prevCapabilitiesVersion = 0;
 
     // publish variables and status
     if (force || millis() - prevPubVars > settings.mqtt.interval) {
@@ -382,6 +482,26 @@ protected:
       publishSettings(getTopicPath("settings").c_str());
       prevPubSettings = millis();
     }
+
+    // publish boiler telemetry
+    if (force || millis() - prevPubTelemetry > settings.mqtt.interval * 10) {
+      publishTelemetry(getTopicPath("telemetry").c_str());
+      prevPubTelemetry = millis();
+    }
+
+    // publish boiler capabilities
+    if (force || prevCapabilitiesVersion != otCapabilities.getVersion()) {
+      publishCapabilities(getTopicPath("capabilities").c_str());
+      prevCapabilitiesVersion = otCapabilities.getVersion();
+    }
+
+    // publish heating curve: the table of the regulator, a new N is published once the regulator has rebuilt it
+    static float prevCurve[5] = {0};
+    float curve[5] = {(float) etRegulator.getTableKn(), settings.equitherm.k_factor, settings.heating.target, (float) settings.heating.minTemp, (float) settings.heating.maxTemp};
+    if (etRegulator.getTable() != nullptr && (force || memcmp(curve, prevCurve, sizeof(curve)) != 0)) {
+      publishCurve(getTopicPath("curve").c_str());
+      memcpy(prevCurve, curve, sizeof(curve));
+    }
   }
 
   static void publishHaEntities() {
@@ -401,6 +521,8 @@ protected:
     haHelper.publishSwitchHeating(false);
     haHelper.publishSwitchHeatingTurbo();
     haHelper.publishNumberHeatingHysteresis();
+    haHelper.publishNumberHeatingSetpointStep(false);
+    haHelper.publishNumberHeatingSetpointDeadband(false);
     haHelper.publishSensorHeatingSetpoint(false);
     haHelper.publishSensorCurrentHeatingMinTemp(false);
     haHelper.publishSensorCurrentHeatingMaxTemp(false);
@@ -559,6 +681,8 @@ protected:
     doc["heating"]["turbo"] = settings.heating.turbo;
     doc["heating"]["target"] = settings.heating.target;
     doc["heating"]["hysteresis"] = settings.heating.hysteresis;
+    doc["heating"]["setpointStep"] = settings.heating.setpointStep;
+    doc["heating"]["setpointDeadband"] = settings.heating.setpointDeadband;
     doc["heating"]["minTemp"] = settings.heating.minTemp;
     doc["heating"]["maxTemp"] = settings.heating.maxTemp;
     doc["heating"]["maxModulation"] = settings.heating.maxModulation;
@@ -596,6 +720,12 @@ protected:
 
     doc["tuning"]["enable"] = vars.tuning.enable;
     doc["tuning"]["regulator"] = vars.tuning.regulator;
+    doc["tuning"]["equitherm"]["state"] = vars.tuning.state;
+    doc["tuning"]["equitherm"]["factor"] = vars.tuning.factor == 'n' ? "n" : "k";
+    doc["tuning"]["equitherm"]["progress"] = vars.tuning.progress;
+    doc["tuning"]["equitherm"]["steps"] = vars.tuning.steps;
+    doc["tuning"]["equitherm"]["converged"] = vars.tuning.converged;
+    doc["tuning"]["equitherm"]["error"] = round(vars.tuning.error * 100) / 100;
 
     doc["states"]["otStatus"] = vars.states.otStatus;
     doc["states"]["heating"] = vars.states.heating;
@@ -623,11 +753,308 @@ protected:
     doc["parameters"]["dhwMinTemp"] = vars.parameters.dhwMinTemp;
     doc["parameters"]["dhwMaxTemp"] = vars.parameters.dhwMaxTemp;
 
+    doc["opentherm"]["missedDeadlines"] = vars.opentherm.missedDeadlines;
+    doc["opentherm"]["memberIdSavedPerHour"] = vars.opentherm.memberIdSavedPerHour;
+    doc["opentherm"]["latency"] = vars.opentherm.latency;
+    doc["opentherm"]["frameGap"] = vars.opentherm.frameGap;
+    doc["opentherm"]["skippedWrites"] = vars.opentherm.skippedWrites;
+    doc["opentherm"]["probeTime"] = vars.opentherm.probeTime;
+    doc["opentherm"]["readyTime"] = vars.opentherm.readyTime;
+    doc["opentherm"]["startupTime"] = vars.opentherm.startupTime;
+    doc["opentherm"]["bus"]["tx"] = round(vars.opentherm.busTx * 10) / 10;
+    doc["opentherm"]["bus"]["rx"] = round(vars.opentherm.busRx * 10) / 10;
+    doc["opentherm"]["bus"]["gap"] = round(vars.opentherm.busGap * 10) / 10;
+    doc["opentherm"]["bus"]["retry"] = round(vars.opentherm.busRetry * 10) / 10;
+    doc["opentherm"]["bus"]["load"] = round((vars.opentherm.busTx + vars.opentherm.busRx + vars.opentherm.busGap + vars.opentherm.busRetry) * 10) / 10;
+
+    if (settings.opentherm.gateway) {
+      doc["opentherm"]["gateway"]["latency"] = vars.opentherm.gatewayLatency;
+      doc["opentherm"]["gateway"]["overhead"] = vars.opentherm.gatewayOverhead;
+      doc["opentherm"]["gateway"]["maxLatency"] = vars.opentherm.gatewayMaxLatency;
+    }
+
+    client.beginPublish(topic, measureJson(doc), false);
+    serializeJson(doc, client);
+    return client.endPublish();
+  }
+
+  // only the values supported by the boiler
+  static bool publishTelemetry(const char* topic) {
+    StaticJsonDocument<512> doc;
+
+    if (otCapabilities.isSupported(OpenThermMessageID::Tret)) {
+      doc["returnTemp"] = vars.telemetry.returnTemp;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::Texhaust)) {
+      doc["exhaustTemp"] = vars.telemetry.exhaustTemp;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::OEMDiagnosticCode)) {
+      doc["oemDiagnosticCode"] = vars.telemetry.oemDiagnosticCode;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::BurnerStarts)) {
+      doc["starts"]["burner"] = vars.telemetry.burnerStarts;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::CHPumpStarts)) {
+      doc["starts"]["chPump"] = vars.telemetry.chPumpStarts;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::DHWPumpValveStarts)) {
+      doc["starts"]["dhwPumpValve"] = vars.telemetry.dhwPumpValveStarts;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::DHWBurnerStarts)) {
+      doc["starts"]["dhwBurner"] = vars.telemetry.dhwBurnerStarts;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::BurnerOperationHours)) {
+      doc["hours"]["burner"] = vars.telemetry.burnerHours;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::CHPumpOperationHours)) {
+      doc["hours"]["chPump"] = vars.telemetry.chPumpHours;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::DHWPumpValveOperationHours)) {
+      doc["hours"]["dhwPumpValve"] = vars.telemetry.dhwPumpValveHours;
+    }
+
+    if (otCapabilities.isSupported(OpenThermMessageID::DHWBurnerOperationHours)) {
+      doc["hours"]["dhwBurner"] = vars.telemetry.dhwBurnerHours;
+    }
+
+    if (doc.isNull()) {
+      return false;
+    }
+
     client.beginPublish(topic, measureJson(doc), false);
     serializeJson(doc, client);
     return client.endPublish();
   }
 
+  // flow temperature of the equitherm curve per 0.5 degree of the outdoor temperature, without the T correction:
+  // the table of the regulator with the K correction and the limits
+  static bool publishCurve(const char* topic) {
+    const auto* table = etRegulator.getTable();
+    if (table == nullptr) {
+      return false;
+    }
+
+    float correction = (settings.heating.target - 20) * settings.equitherm.k_factor;
+
+    StaticJsonDocument<2560> doc;
+    doc["kn"] = (float) etRegulator.getTableKn();
+    doc["kk"] = settings.equitherm.k_factor;
+    doc["target"] = settings.heating.target;
+    doc["outdoor"]["min"] = EQUITHERM_TABLE_MIN;
+    doc["outdoor"]["max"] = EQUITHERM_TABLE_MAX;
+    doc["outdoor"]["step"] = 1.0f / EQUITHERM_TABLE_STEPS;
+
+    JsonArray flow = doc.createNestedArray("flow");
+    for (int i = 0; i < EQUITHERM_TABLE_SIZE; i++) {
+      float value = constrain((float) table[i] + correction, (float) settings.heating.minTemp, (float) settings.heating.maxTemp);
+      flow.add(round(value * 10) / 10);
+    }
+
+    client.beginPublish(topic, measureJson(doc), true);
+    serializeJson(doc, client);
+    return client.endPublish();
+  }
+
+  static bool publishCapabilities(const char* topic) {
+    StaticJsonDocument<2048> doc;
+    JsonArray supported = doc.createNestedArray("supported");
+    JsonArray unsupported = doc.createNestedArray("unsupported");
+
+    for (unsigned int id = 0; id < 256; id++) {
+      if (OpenThermCapabilities::getBit(otCapabilities.getSupported(), id)) {
+        supported.add(id);
+
+      } else if (OpenThermCapabilities::getBit(otCapabilities.getUnsupported(), id)) {
+        unsupported.add(id);
+      }
+    }
+
+    doc["slave"]["memberIdCode"] = vars.parameters.slaveMemberIdCode;
+    doc["slave"]["type"] = vars.parameters.slaveType;
+    doc["slave"]["version"] = vars.parameters.slaveVersion;
+
+    uint8_t flags = vars.parameters.slaveFlags;
+    doc["slave"]["config"]["dhwPresent"] = (bool) (flags & 0x01);
+    doc["slave"]["config"]["controlType"] = (bool) (flags & 0x02);
+    doc["slave"]["config"]["cooling"] = (bool) (flags & 0x04);
+    doc["slave"]["config"]["dhwConfig"] = (bool) (flags & 0x08);
+    doc["slave"]["config"]["pumpControl"] = (bool) (flags & 0x10);
+    doc["slave"]["config"]["ch2Present"] = (bool) (flags & 0x20);
+    doc["slave"]["config"]["remoteWaterFilling"] = (bool) (flags & 0x40);
+    doc["slave"]["config"]["heatCoolModeControl"] = (bool) (flags & 0x80);
+
+    client.beginPublish(topic, measureJson(doc), true);
+    serializeJson(doc, client);
+    return client.endPublish();
+  }
+
+  static void publishStats() {
+    char topic[16];
+
+    for (byte i = 0; i < otStats.size(); i++) {
+      const OpenThermStats::Item& item = otStats.getItem(i);
+      StaticJsonDocument<512> doc;
+
+      doc["id"] = item.id;
+      doc["success"] = item.success;
+      doc["invalid"] = item.invalid;
+      doc["timeout"] = item.timeout;
+      doc["retries"] = item.retries;
+
+      JsonArray latency = doc.createNestedArray("latency");
+      for (byte bucket = 0; bucket < OT_STATS_BUCKETS; bucket++) {
+        JsonObject latencyBucket = latency.createNestedObject();
+        latencyBucket["le"] = OpenThermStats::getBucketLimit(bucket);
+        latencyBucket["count"] = item.latency[bucket];
+      }
+
+      sprintf(topic, "stats/%u", item.id);
+      client.beginPublish(getTopicPath(topic).c_str(), measureJson(doc), false);
+      serializeJson(doc, client);
+      client.endPublish();
+
+      // Feeding the watchdog
+      ::yield();
+    }
+
+    Log.sinfoln("MQTT", PSTR("Published stats for %u ids, overflow: %lu"), otStats.size(), otStats.getOverflow());
+  }
+
+  static bool publishRawFrames(const char* topic) {
+    StaticJsonDocument<2048> doc;
+
+    JsonArray frames = doc.createNestedArray("frames");
+    for (byte i = 0; i < otRawBatch.size(); i++) {
+      const OpenThermRawBatch::Frame& frame = otRawBatch.get(i);
+      JsonObject item = frames.createNestedObject();
+
+      item["id"] = (frame.request >> 16) & 0xFF;
+      item["request"] = frame.request;
+      item["response"] = frame.response;
+      item["status"] = ot->statusToString(frame.status);
+
+      if (frame.status == OpenThermResponseStatus::SUCCESS || frame.status == OpenThermResponseStatus::INVALID) {
+        item["type"] = ot->messageTypeToString(ot->getMessageType(frame.response));
+      }
+    }
+
+    client.beginPublish(topic, measureJson(doc), false);
+    serializeJson(doc, client);
+    bool result = client.endPublish();
+
+    Log.sinfoln("MQTT", PSTR("Published responses for %u raw frames"), otRawBatch.size());
+    return result;
+  }
+
+  // binary: little-endian entries of 12 bytes (ts 24 bit | attempt 4 bit | status 4 bit, request, response), from the oldest one
+  static void dumpTrace(byte format) {
+    otTrace.pause();
+
+    if (format == 1) {
+      client.beginPublish(getTopicPath("trace").c_str(), otTrace.size() * sizeof(OpenThermTrace::Entry), false);
+
+      for (unsigned int i = 0; i < otTrace.size(); i++) {
+        const OpenThermTrace::Entry& entry = otTrace.get(i);
+        client.write((const uint8_t*) &entry, sizeof(OpenThermTrace::Entry));
+
+        // Feeding the watchdog
+        if (i % 64 == 0) {
+          ::yield();
+        }
+      }
+
+      client.endPublish();
+
+    } else {
+      for (unsigned int i = 0; i < otTrace.size(); i++) {
+        const OpenThermTrace::Entry& entry = otTrace.get(i);
+
+        Log.sinfoln(
+          "OT.TRACE",
+          PSTR("%10lu   ID: %4lu   Request: %8lx   Response: %8lx   Attempt: %2u   Status: %s"),
+          OpenThermTrace::getTs(entry),
+          (OpenThermTrace::getRequest(entry) >> 16) & 0xFF,
+          OpenThermTrace::getRequest(entry),
+          OpenThermTrace::getResponse(entry),
+          OpenThermTrace::getAttempt(entry),
+          OpenThermTrace::getStatusName(entry)
+        );
+
+        ::yield();
+      }
+    }
+
+    Log.sinfoln("MQTT", PSTR("Trace dumped, frames: %u"), otTrace.size());
+    otTrace.resume();
+  }
+
+  // {"frames": [<32 bit frame>, "0x00730000", {"type": "read", "id": 115, "data": 0}, ...]}, the parity bit is recalculated
+  static bool updateRawFrames(JsonDocument& doc) {
+    if (ot == nullptr || doc["frames"].isNull() || !doc["frames"].is<JsonArray>()) {
+      return false;
+    }
+
+    if (settings.opentherm.rawBudget == 0) {
+      Log.swarningln("MQTT", PSTR("Raw frames ignored, disabled by the bus time setting"));
+      return false;
+    }
+
+    if (!otRawBatch.isEmpty()) {
+      Log.swarningln("MQTT", PSTR("Raw frames ignored, the previous batch is not finished"));
+      return false;
+    }
+
+    for (JsonVariant frame : doc["frames"].as<JsonArray>()) {
+      unsigned long request;
+
+      if (frame.is<const char*>()) {
+        request = strtoul(frame.as<const char*>(), nullptr, 0);
+
+      } else if (frame.is<unsigned long>()) {
+        request = frame.as<unsigned long>();
+
+      } else if (frame["id"].is<unsigned int>() && frame["type"].is<const char*>()) {
+        bool write = strcmp(frame["type"].as<const char*>(), "write") == 0;
+        if (!write && strcmp(frame["type"].as<const char*>(), "read") != 0) {
+          Log.swarningln("MQTT", PSTR("Raw frame #%u skipped: type must be read or write"), otRawBatch.size());
+          continue;
+        }
+
+        request = (unsigned long) (write ? OpenThermMessageType::WRITE_DATA : OpenThermMessageType::READ_DATA) << 28;
+        request |= ((unsigned long) frame["id"].as<unsigned int>() & 0xFF) << 16 | (frame["data"].as<unsigned int>() & 0xFFFF);
+
+      } else {
+        Log.swarningln("MQTT", PSTR("Raw frame #%u skipped: invalid format"), otRawBatch.size());
+        continue;
+      }
+
+      // only read and write data frames can be sent by the master
+      OpenThermMessageType type = (OpenThermMessageType) ((request >> 28) & 0x7);
+      if (type != OpenThermMessageType::READ_DATA && type != OpenThermMessageType::WRITE_DATA) {
+        Log.swarningln("MQTT", PSTR("Raw frame #%u skipped: type must be read or write"), otRawBatch.size());
+        continue;
+      }
+
+      if (!otRawBatch.add(ot->buildRequest(type, (OpenThermMessageID) ((request >> 16) & 0xFF), request & 0xFFFF))) {
+        Log.swarningln("MQTT", PSTR("Raw frames: more than %u in the batch, the rest is skipped"), OT_RAW_MAX_FRAMES);
+        break;
+      }
+    }
+
+    Log.sinfoln("MQTT", PSTR("Queued %u raw frames"), otRawBatch.size());
+    otRawBatch.queue();
+    return !otRawBatch.isEmpty();
+  }
+
   static std::string getTopicPath(const char* topic) {
     return std::string(settings.mqtt.prefix) + "/" + std::string(topic);
   }
@@ -689,6 +1116,10 @@ protected:
     } else if (getTopicPath("settings/set").compare(topic) == 0) {
       updateSettings(doc);
       client.publish(getTopicPath("settings/set").c_str(), NULL, true);
+
+    } else if (getTopicPath("raw/set").compare(topic) == 0) {
+      updateRawFrames(doc);
+      client.publish(getTopicPath("raw/set").c_str(), NULL, true);
     }
   }
 };
\ No newline at end of file
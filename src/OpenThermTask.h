@@ -1,21 +1,104 @@
 #include <new>
 #include <CustomOpenTherm.h>
-
-CustomOpenTherm* ot;
+#include <OpenThermTransport.h>
+#include <OpenThermScheduler.h>
+#include <OpenThermCapabilities.h>
+#include <OpenThermDecoder.h>
+#include <OpenThermGateway.h>
+#include <OpenThermRawBatch.h>
+
+OpenThermCapabilities otCapabilities;
+// filled and published by the MqttTask, sent by the OpenThermTask
+OpenThermRawBatch otRawBatch;
+extern CustomOpenTherm* ot;
+extern OpenThermTransport otTransport;
+extern OpenThermGateway otGateway;
 extern Variables vars;
 extern Settings settings;
 extern EEManager eeSettings;
+extern BoilerProfile boilerProfile;
+extern EEManager eeProfile;
 extern TinyLogger Log;
 
+// polled values which are decoded without extra logic
+constexpr OpenThermDataField otDataFields[] = {
+  OpenThermDecoder::bytes(OpenThermMessageID::ASFflags, OpenThermDataType::FLAG8, nullptr, &vars.sensors.faultCode),
+  OpenThermDecoder::number(OpenThermMessageID::RelModLevel, OpenThermDataType::F88, &vars.sensors.modulation),
+  OpenThermDecoder::number(OpenThermMessageID::CHPressure, OpenThermDataType::F88, &vars.sensors.pressure),
+  OpenThermDecoder::number(OpenThermMessageID::DHWFlowRate, OpenThermDataType::F88, &vars.sensors.dhwFlowRate),
+  OpenThermDecoder::number(OpenThermMessageID::Tboiler, OpenThermDataType::F88, &vars.temperatures.heating),
+  OpenThermDecoder::number(OpenThermMessageID::Tdhw, OpenThermDataType::F88, &vars.temperatures.dhw),
+  OpenThermDecoder::number(OpenThermMessageID::Toutside, OpenThermDataType::F88, &vars.temperatures.outdoor, 1, &settings.sensors.outdoor.offset),
+  OpenThermDecoder::bytes(OpenThermMessageID::TdhwSetUBTdhwSetLB, OpenThermDataType::U8U8_BOUNDS, &vars.parameters.dhwMaxTemp, &vars.parameters.dhwMinTemp),
+  OpenThermDecoder::bytes(OpenThermMessageID::MaxTSetUBMaxTSetLB, OpenThermDataType::U8U8_BOUNDS, &vars.parameters.heatingMaxTemp, &vars.parameters.heatingMinTemp),
+  OpenThermDecoder::bytes(OpenThermMessageID::MasterVersion, OpenThermDataType::U8U8, &vars.parameters.masterType, &vars.parameters.masterVersion),
+  OpenThermDecoder::bytes(OpenThermMessageID::SlaveVersion, OpenThermDataType::U8U8, &vars.parameters.slaveType, &vars.parameters.slaveVersion),
+
+  // telemetry
+  OpenThermDecoder::number(OpenThermMessageID::Tret, OpenThermDataType::F88, &vars.telemetry.returnTemp),
+  OpenThermDecoder::number(OpenThermMessageID::Texhaust, OpenThermDataType::S16, &vars.telemetry.exhaustTemp),
+  OpenThermDecoder::word(OpenThermMessageID::OEMDiagnosticCode, &vars.telemetry.oemDiagnosticCode),
+  OpenThermDecoder::word(OpenThermMessageID::BurnerStarts, &vars.telemetry.burnerStarts),
+  OpenThermDecoder::word(OpenThermMessageID::CHPumpStarts, &vars.telemetry.chPumpStarts),
+  OpenThermDecoder::word(OpenThermMessageID::DHWPumpValveStarts, &vars.telemetry.dhwPumpValveStarts),
+  OpenThermDecoder::word(OpenThermMessageID::DHWBurnerStarts, &vars.telemetry.dhwBurnerStarts),
+  OpenThermDecoder::word(OpenThermMessageID::BurnerOperationHours, &vars.telemetry.burnerHours),
+  OpenThermDecoder::word(OpenThermMessageID::CHPumpOperationHours, &vars.telemetry.chPumpHours),
+  OpenThermDecoder::word(OpenThermMessageID::DHWPumpValveOperationHours, &vars.telemetry.dhwPumpValveHours),
+  OpenThermDecoder::word(OpenThermMessageID::DHWBurnerOperationHours, &vars.telemetry.dhwBurnerHours)
+};
+
+// values of the boiler read by the thermostat in the gateway mode, its limits and versions are not the own ones
+constexpr OpenThermDataField otGatewayFields[] = {
+  OpenThermDecoder::bytes(OpenThermMessageID::ASFflags, OpenThermDataType::FLAG8, nullptr, &vars.sensors.faultCode),
+  OpenThermDecoder::number(OpenThermMessageID::RelModLevel, OpenThermDataType::F88, &vars.sensors.modulation),
+  OpenThermDecoder::number(OpenThermMessageID::CHPressure, OpenThermDataType::F88, &vars.sensors.pressure),
+  OpenThermDecoder::number(OpenThermMessageID::DHWFlowRate, OpenThermDataType::F88, &vars.sensors.dhwFlowRate),
+  OpenThermDecoder::number(OpenThermMessageID::Tboiler, OpenThermDataType::F88, &vars.temperatures.heating),
+  OpenThermDecoder::number(OpenThermMessageID::Tdhw, OpenThermDataType::F88, &vars.temperatures.dhw),
+  OpenThermDecoder::number(OpenThermMessageID::Toutside, OpenThermDataType::F88, &vars.temperatures.outdoor, 1, &settings.sensors.outdoor.offset)
+};
+
+// standard ids probed once per boiler, read only: the write-only ones are learned from the poll plan
+constexpr OpenThermMessageID otProbeIds[] = {
+  OpenThermMessageID::ASFflags,
+  OpenThermMessageID::RBPflags,
+  OpenThermMessageID::MaxCapacityMinModLevel,
+  OpenThermMessageID::RelModLevel,
+  OpenThermMessageID::CHPressure,
+  OpenThermMessageID::DHWFlowRate,
+  OpenThermMessageID::Tboiler,
+  OpenThermMessageID::Tdhw,
+  OpenThermMessageID::Toutside,
+  OpenThermMessageID::Tret,
+  OpenThermMessageID::Tstorage,
+  OpenThermMessageID::Tcollector,
+  OpenThermMessageID::TflowCH2,
+  OpenThermMessageID::Tdhw2,
+  OpenThermMessageID::Texhaust,
+  OpenThermMessageID::TdhwSetUBTdhwSetLB,
+  OpenThermMessageID::MaxTSetUBMaxTSetLB,
+  OpenThermMessageID::TdhwSet,
+  OpenThermMessageID::MaxTSet,
+  OpenThermMessageID::OEMDiagnosticCode,
+  OpenThermMessageID::BurnerStarts,
+  OpenThermMessageID::CHPumpStarts,
+  OpenThermMessageID::DHWPumpValveStarts,
+  OpenThermMessageID::DHWBurnerStarts,
+  OpenThermMessageID::BurnerOperationHours,
+  OpenThermMessageID::CHPumpOperationHours,
+  OpenThermMessageID::DHWPumpValveOperationHours,
+  OpenThermMessageID::DHWBurnerOperationHours,
+  OpenThermMessageID::OpenThermVersionSlave
+};
+constexpr byte otProbeCount = sizeof(otProbeIds) / sizeof(otProbeIds[0]);
+static_assert(otProbeCount <= 32, "the probe rounds keep a bit per id of otProbeIds in uint32_t");
+
 
 class OpenThermTask : public Task {
 public:
   OpenThermTask(bool _enabled = false, unsigned long _interval = 0) : Task(_enabled, _interval) {}
 
-  void static IRAM_ATTR handleInterrupt() {
-    ot->handleInterrupt();
-  }
-
 protected:
   const char* getTaskName() {
     return "OpenTherm";
@@ -26,19 +109,45 @@ protected:
   }
 
   void setup() {
-    ot = new CustomOpenTherm(settings.opentherm.inPin, settings.opentherm.outPin);
-
-    ot->setHandleSendRequestCallback(this->sendRequestCallback);
-    ot->begin(OpenThermTask::handleInterrupt, this->responseCallback);
-
-    ot->setYieldCallback([](void* self) {
-      static_cast<OpenThermTask*>(self)->delay(10);
-    }, this);
-
-    #ifdef LED_OT_RX_PIN
-      pinMode(LED_OT_RX_PIN, OUTPUT);
-      digitalWrite(LED_OT_RX_PIN, false);
-    #endif
+    otCapabilities.setTreshold(OPENTHERM_UNSUPPORTED_TRESHOLD);
+    otCapabilities.setReprobeInterval(OPENTHERM_REPROBE_INTERVAL);
+
+    // poll plan: id, priority, period, deadline
+    scheduler.add(OpenThermMessageID::Status, 0, 900, 1150);
+    scheduler.add(OpenThermMessageID::TSet, 0, 900, 1150);
+    scheduler.add(OpenThermMessageID::TsetCH2, 1, 900);
+    scheduler.add(OpenThermMessageID::Tboiler, 1, 2000, 5000);
+    scheduler.add(OpenThermMessageID::RelModLevel, 1, 2000, 5000);
+    scheduler.add(OpenThermMessageID::MaxRelModLevelSetting, 1, 5000);
+    scheduler.add(OpenThermMessageID::TdhwSet, 1, dhwSetTempInterval);
+    scheduler.add(OpenThermMessageID::Tdhw, 2, 5000);
+    scheduler.add(OpenThermMessageID::ASFflags, 2, 10000);
+    scheduler.add(OpenThermMessageID::CHPressure, 3, 10000);
+    scheduler.add(OpenThermMessageID::DHWFlowRate, 3, 10000);
+    scheduler.add(OpenThermMessageID::Toutside, 3, 60000);
+    scheduler.add(OpenThermMessageID::SlaveVersion, 4, 60000);
+    scheduler.add(OpenThermMessageID::MasterVersion, 4, 60000);
+    scheduler.add(OpenThermMessageID::TdhwSetUBTdhwSetLB, 4, 60000);
+    scheduler.add(OpenThermMessageID::MaxTSetUBMaxTSetLB, 4, 60000);
+    scheduler.add(OpenThermMessageID::MaxTSet, 4, 60000);
+
+    // telemetry, only when the bus has slack
+    scheduler.addLazy(OpenThermMessageID::Tret, 10000);
+    scheduler.addLazy(OpenThermMessageID::Texhaust, 10000);
+    scheduler.addLazy(OpenThermMessageID::OEMDiagnosticCode, 60000);
+    scheduler.addLazy(OpenThermMessageID::BurnerStarts, 300000);
+    scheduler.addLazy(OpenThermMessageID::CHPumpStarts, 300000);
+    scheduler.addLazy(OpenThermMessageID::DHWPumpValveStarts, 300000);
+    scheduler.addLazy(OpenThermMessageID::DHWBurnerStarts, 300000);
+    scheduler.addLazy(OpenThermMessageID::BurnerOperationHours, 300000);
+    scheduler.addLazy(OpenThermMessageID::CHPumpOperationHours, 300000);
+    scheduler.addLazy(OpenThermMessageID::DHWPumpValveOperationHours, 300000);
+    scheduler.addLazy(OpenThermMessageID::DHWBurnerOperationHours, 300000);
+
+    // the decoder of every item is looked up once, the responses take it by the index of the item
+    for (byte i = 0; i < scheduler.size(); i++) {
+      pollFields[i] = OpenThermDecoder::find(otDataFields, scheduler.getId(i));
+    }
 
     #ifdef HEATING_STATUS_PIN
       pinMode(HEATING_STATUS_PIN, OUTPUT);
@@ -47,275 +156,389 @@ protected:
   }
 
   void loop() {
-    static byte currentHeatingTemp, currentDhwTemp = 0;
-    unsigned long localResponse;
+    // the frame is on the wire while the rest of the loop runs
+    if (pollIndex >= 0 && pollRequest.isDone()) {
+      OpenThermMessageID id = scheduler.getId(pollIndex);
+      if (vars.states.otStatus) {
+        otCapabilities.handleResponse(pollRequest.request, pollRequest.response, pollRequest.status);
+      }
 
-    if (setMasterMemberIdCode()) {
-      Log.straceln("OT", PSTR("Slave member id code: %u"), vars.parameters.slaveMemberIdCode);
-      Log.straceln("OT", PSTR("Master member id code: %u"), settings.opentherm.memberIdCode > 0 ? settings.opentherm.memberIdCode : vars.parameters.slaveMemberIdCode);
+      handlePollResponse(id, pollFields[pollIndex], pollRequest.request, pollRequest.response, pollRequest.status);
+      scheduler.done(pollIndex, pollTime);
+      pollIndex = -1;
 
-    } else {
-      Log.swarningln("OT", PSTR("Slave member id failed"));
+      vars.opentherm.latency = ot->getLatency();
+      vars.opentherm.frameGap = ot->getFrameGap();
+
+      if (vars.opentherm.missedDeadlines != scheduler.getMissedDeadlines()) {
+        vars.opentherm.missedDeadlines = scheduler.getMissedDeadlines();
+        Log.straceln("OT", PSTR("Missed deadline for ID: %u, total: %lu"), (unsigned int) id, vars.opentherm.missedDeadlines);
+      }
+    }
+
+    if (probe.pending && probeRequest.isDone()) {
+      handleProbeResponse();
     }
 
-    bool heatingEnabled = (vars.states.emergency || settings.heating.enable) && pump && isReady();
-    bool heatingCh2Enabled = settings.opentherm.heatingCh2Enabled;
+    if (breaker.pending && breakerRequest.isDone()) {
+      handleBreakerResponse();
+    }
+
+    // gateway mode: the thermostat polls the boiler, the values of its frames replace the own polls
+    OpenThermGateway::Frame frame;
+    while (otGateway.observed.pop(frame)) {
+      if (vars.states.otStatus) {
+        otCapabilities.handleResponse(frame.request, frame.response, frame.status);
+      }
+
+      handleGatewayResponse(frame.request, frame.response);
+    }
+
+    heatingEnabled = (vars.states.emergency || settings.heating.enable) && pump && isReady();
+    bool dhwEnabled = settings.opentherm.dhwPresent && settings.dhw.enable;
+
+    heatingCh2Enabled = settings.opentherm.heatingCh2Enabled;
     if (settings.opentherm.heatingCh1ToCh2) {
       heatingCh2Enabled = heatingEnabled;
 
     } else if (settings.opentherm.dhwToCh2) {
-      heatingCh2Enabled = settings.opentherm.dhwPresent && settings.dhw.enable;
+      heatingCh2Enabled = dhwEnabled;
     }
 
-    localResponse = ot->setBoilerStatus(
-      heatingEnabled,
-      settings.opentherm.dhwPresent && settings.dhw.enable,
-      false,
-      false,
-      heatingCh2Enabled,
-      settings.opentherm.summerWinterMode,
-      settings.opentherm.dhwBlocking
-    );
+    if (!settings.opentherm.dhwPresent) {
+      vars.temperatures.dhw = 0;
+      vars.sensors.dhwFlowRate = 0.0f;
+    }
 
-    if (!ot->isValidResponse(localResponse)) {
-      Log.swarningln("OT", PSTR("Invalid response after setBoilerStatus: %s"), ot->statusToString(ot->getLastResponseStatus()));
-      return;
+    if (!dhwEnabled && !settings.heating.enable && !heatingEnabled) {
+      vars.sensors.modulation = 0;
     }
 
-    if (vars.parameters.heatingEnabled != heatingEnabled) {
-      vars.parameters.heatingEnabled = heatingEnabled;
-      Log.sinfoln("OT.HEATING", "%s", heatingEnabled ? "Enabled" : "Disabled");
+    scheduler.setEnabled(OpenThermMessageID::TSet, heatingEnabled);
+    scheduler.setEnabled(OpenThermMessageID::TsetCH2, (settings.opentherm.heatingCh1ToCh2 && heatingEnabled) || (settings.opentherm.dhwToCh2 && dhwEnabled));
+    scheduler.setEnabled(OpenThermMessageID::RelModLevel, dhwEnabled || settings.heating.enable || heatingEnabled);
+    scheduler.setEnabled(OpenThermMessageID::TdhwSet, dhwEnabled);
+    scheduler.setEnabled(OpenThermMessageID::Tdhw, settings.opentherm.dhwPresent);
+    scheduler.setEnabled(OpenThermMessageID::DHWFlowRate, settings.opentherm.dhwPresent);
+    scheduler.setEnabled(OpenThermMessageID::TdhwSetUBTdhwSetLB, settings.opentherm.dhwPresent);
+    scheduler.setEnabled(OpenThermMessageID::Toutside, settings.sensors.outdoor.type == 0);
+    scheduler.setEnabled(OpenThermMessageID::ASFflags, vars.states.fault);
+
+    if (heatingEnabled != vars.parameters.heatingEnabled) {
+      scheduler.force(OpenThermMessageID::Status);
+      scheduler.force(OpenThermMessageID::MaxRelModLevelSetting);
+    }
 
-      #ifdef HEATING_STATUS_PIN
-      digitalWrite(HEATING_STATUS_PIN, heatingEnabled);
-      #endif
+    // once per new setpoint, the rejected one waits for OPENTHERM_REJECTED_WRITE_INTERVAL
+    if (heatingEnabled && isHeatingSetpointChanged() && forcedHeatingTemp != ot->temperatureToData(vars.parameters.heatingSetpoint)) {
+      forcedHeatingTemp = ot->temperatureToData(vars.parameters.heatingSetpoint);
+      scheduler.force(OpenThermMessageID::TSet);
+      Log.sinfoln("OT.HEATING", PSTR("Set temp = %.2f"), vars.parameters.heatingSetpoint);
     }
 
-    vars.states.heating = ot->isCentralHeatingActive(localResponse);
-    vars.states.dhw = settings.opentherm.dhwPresent ? ot->isHotWaterActive(localResponse) : false;
-    vars.states.flame = ot->isFlameOn(localResponse);
-    vars.states.fault = ot->isFault(localResponse);
-    vars.states.diagnostic = ot->isDiagnostic(localResponse);
+    if (dhwEnabled && getDhwTarget() != currentDhwTemp && forcedDhwTemp != getDhwTarget()) {
+      forcedDhwTemp = getDhwTarget();
+      scheduler.force(OpenThermMessageID::TdhwSet);
+      Log.sinfoln("OT.DHW", PSTR("Set temp = %u"), getDhwTarget());
+    }
 
-    setMaxModulationLevel(heatingEnabled ? settings.heating.maxModulation : 0);
-    yield();
+    // circuit breaker: the boiler does not answer, the poll plan stops
+    if (vars.states.otStatus == breaker.open) {
+      breaker.open = !vars.states.otStatus;
+      breaker.interval = OPENTHERM_OFFLINE_PROBE_MIN;
+      breaker.lastProbe = millis();
 
-    // Команды чтения данных котла
-    if (millis() - prevUpdateNonEssentialVars > 60000) {
-      updateSlaveParameters();
-      updateMasterParameters();
+      if (breaker.open) {
+        Log.swarningln("OT", PSTR("No answers from the boiler, polling is paused"));
 
-      Log.straceln("OT", PSTR("Master type: %u, version: %u"), vars.parameters.masterType, vars.parameters.masterVersion);
-      Log.straceln("OT", PSTR("Slave type: %u, version: %u"), vars.parameters.slaveType, vars.parameters.slaveVersion);
+      } else {
+        // everything is stale after the pause
+        scheduler.reset();
+      }
+    }
 
-      // DHW min/max temp
-      if (settings.opentherm.dhwPresent) {
-        if (updateMinMaxDhwTemp()) {
-          if (settings.dhw.minTemp < vars.parameters.dhwMinTemp) {
-            settings.dhw.minTemp = vars.parameters.dhwMinTemp;
-            eeSettings.update();
-            Log.snoticeln("OT.DHW", PSTR("Updated min temp: %d"), settings.dhw.minTemp);
-          }
-
-          if (settings.dhw.maxTemp > vars.parameters.dhwMaxTemp) {
-            settings.dhw.maxTemp = vars.parameters.dhwMaxTemp;
-            eeSettings.update();
-            Log.snoticeln("OT.DHW", PSTR("Updated max temp: %d"), settings.dhw.maxTemp);
-          }
-
-        } else {
-          Log.swarningln("OT.DHW", PSTR("Failed get min/max temp"));
-        }
+    // boiler link session
+    if (vars.states.otStatus != session.online) {
+      session.online = vars.states.otStatus;
 
-        if (settings.dhw.minTemp >= settings.dhw.maxTemp) {
-          settings.dhw.minTemp = 30;
-          settings.dhw.maxTemp = 60;
-          eeSettings.update();
-        }
+      if (session.online) {
+        session.negotiated = false;
+        session.lastNegotiation = 0;
+        session.slaveConfig = 0;
+        probe.identified = false;
+        probe.lastIdentify = 0;
+        otCapabilities.resetFailures();
+        ot->resetWriteCache();
+        Log.sinfoln("OT", PSTR("Link is up"));
+
+      } else {
+        Log.swarningln("OT", PSTR("Link is down"));
       }
+    }
 
+    if (session.negotiated && session.memberIdCode != settings.opentherm.memberIdCode) {
+      session.negotiated = false;
+      session.lastNegotiation = 0;
+    }
 
-      // Heating min/max temp
-      if (updateMinMaxHeatingTemp()) {
-        if (settings.heating.minTemp < vars.parameters.heatingMinTemp) {
-          settings.heating.minTemp = vars.parameters.heatingMinTemp;
-          eeSettings.update();
-          Log.snoticeln("OT.HEATING", PSTR("Updated min temp: %d"), settings.heating.minTemp);
-        }
+    if (!otGateway.isActive() && session.online && !session.negotiated && (session.lastNegotiation == 0 || millis() - session.lastNegotiation > 10000)) {
+      negotiateSession();
+    }
 
-        if (settings.heating.maxTemp > vars.parameters.heatingMaxTemp) {
-          settings.heating.maxTemp = vars.parameters.heatingMaxTemp;
-          eeSettings.update();
-          Log.snoticeln("OT.HEATING", PSTR("Updated max temp: %d"), settings.heating.maxTemp);
-        }
+    if (!otGateway.isActive() && session.online && !probe.identified && (probe.lastIdentify == 0 || millis() - probe.lastIdentify > 10000)) {
+      identifyBoiler();
+    }
+
+    // only a status probe, each failure doubles the interval
+    if (breaker.open && pollIndex < 0 && !breaker.pending && !otGateway.isActive() && millis() - breaker.lastProbe >= breaker.interval) {
+      submitBreakerProbe();
+    }
+
+    // the previous poll is done: take the next item of the poll plan
+    if (!breaker.open && pollIndex < 0 && !probe.pending && !otGateway.isActive()) {
+      // lazy items must fit before the next regular one
+      unsigned long window = ot->getLatency() + ot->getFrameGap();
+
+      // the probe sweep only yields to the control items, the rest of the plan waits a few seconds once per boiler
+      if (isProbeDue() && session.online && scheduler.isIdle(millis(), window, 2)) {
+        submitProbe();
 
       } else {
-        Log.swarningln("OT.HEATING", PSTR("Failed get min/max temp"));
+        pollIndex = scheduler.next(millis(), window);
       }
 
-      if (settings.heating.minTemp >= settings.heating.maxTemp) {
-        settings.heating.minTemp = 20;
-        settings.heating.maxTemp = 90;
-        eeSettings.update();
-      }
+      while (pollIndex >= 0) {
+        OpenThermMessageID id = scheduler.getId(pollIndex);
+
+        // ids rejected by the boiler only get an occasional re-probe
+        if (!isPollable(id)) {
+          scheduler.skip(pollIndex, millis());
+          pollIndex = scheduler.next(millis(), window);
+          continue;
+        }
+
+        pollRequest.request = buildPollRequest(id);
 
-      // force
-      setMaxHeatingTemp(settings.heating.maxTemp);
+        // the value may be already acknowledged by the boiler
+        if (!ot->needWrite(pollRequest.request)) {
+          vars.opentherm.skippedWrites++;
+          scheduler.skip(pollIndex, millis());
+          pollIndex = scheduler.next(millis(), window);
+          continue;
+        }
+
+        if (otTransport.submit(OT_TRANSPORT_CONTROL, pollRequest)) {
+          pollTime = millis();
+          break;
+        }
 
-      if (settings.sensors.outdoor.type == 0) {
-        updateOutsideTemp();
+        // the queue is full: the item stays due and is taken again by the next loop
+        pollIndex = -1;
+        break;
       }
+    }
+
+    handleRawFrames();
 
-      if (vars.states.fault) {
-        updateFaultCode();
+    // коммутационная разность (hysteresis)
+    // только для pid и/или equitherm, не при подборе кривой: гистерезис скрывает её ошибку
+    bool equithermTuning = vars.tuning.enable && vars.tuning.regulator == 0;
+    if (settings.heating.hysteresis > 0 && !vars.states.emergency && !equithermTuning && (settings.equitherm.enable || settings.pid.enable)) {
+      float halfHyst = settings.heating.hysteresis / 2;
+      if (pump && vars.temperatures.indoor - settings.heating.target + 0.0001 >= halfHyst) {
+        pump = false;
+
+      } else if (!pump && vars.temperatures.indoor - settings.heating.target - 0.0001 <= -(halfHyst)) {
+        pump = true;
       }
 
-      prevUpdateNonEssentialVars = millis();
-      yield();
+    } else if (!pump) {
+      pump = true;
     }
 
-    updatePressure();
-    if ((settings.opentherm.dhwPresent && settings.dhw.enable) || settings.heating.enable || heatingEnabled) {
-      updateModulationLevel();
+    delay(pollIndex >= 0 || breaker.pending ? 2 : 10);
+  }
 
-    } else {
-      vars.sensors.modulation = 0;
-    }
-    yield();
+  unsigned long buildPollRequest(OpenThermMessageID id) {
+    switch (id) {
+    case OpenThermMessageID::Status:
+      return ot->buildSetBoilerStatusRequest(
+        heatingEnabled,
+        settings.opentherm.dhwPresent && settings.dhw.enable,
+        false,
+        false,
+        heatingCh2Enabled,
+        settings.opentherm.summerWinterMode,
+        settings.opentherm.dhwBlocking
+      );
 
-    if (settings.opentherm.dhwPresent) {
-      updateDhwTemp();
-      updateDhwFlowRate();
-    } else {
-      vars.temperatures.dhw = 0;
-      vars.sensors.dhwFlowRate = 0.0f;
-    }
+    case OpenThermMessageID::TSet:
+      return ot->buildRequest(OpenThermMessageType::WRITE_DATA, id, ot->temperatureToData(vars.parameters.heatingSetpoint));
 
-    updateHeatingTemp();
-    yield();
+    case OpenThermMessageID::TsetCH2:
+      return ot->buildRequest(
+        OpenThermMessageType::WRITE_DATA,
+        id,
+        ot->temperatureToData(settings.opentherm.heatingCh1ToCh2 ? vars.parameters.heatingSetpoint : getDhwTarget())
+      );
 
-    // fault reset action
-    if (vars.actions.resetFault) {
-      if (vars.states.fault) {
-        if (ot->sendBoilerReset()) {
-          Log.sinfoln("OT", PSTR("Boiler fault reset successfully"));
+    case OpenThermMessageID::TdhwSet:
+      return ot->buildRequest(OpenThermMessageType::WRITE_DATA, id, ot->temperatureToData(getDhwTarget()));
 
-        } else {
-          Log.serrorln("OT", PSTR("Boiler fault reset failed"));
-        }
-      }
+    case OpenThermMessageID::MaxRelModLevelSetting:
+      return ot->buildRequest(OpenThermRequestType::WRITE, id, (unsigned int) ((heatingEnabled ? settings.heating.maxModulation : 0) * 256));
+
+    case OpenThermMessageID::MaxTSet:
+      return ot->buildRequest(OpenThermMessageType::WRITE_DATA, id, ot->temperatureToData(settings.heating.maxTemp));
 
-      vars.actions.resetFault = false;
-      yield();
+    case OpenThermMessageID::MasterVersion:
+      return ot->buildRequest(OpenThermRequestType::WRITE, id, 0x013F);
+
+    default:
+      return ot->buildRequest(OpenThermRequestType::READ, id, 0);
     }
+  }
+
+  // field - decoder of the plain value of the id, nullptr if the id has none
+  void handlePollResponse(OpenThermMessageID id, const OpenThermDataField* field, unsigned long request, unsigned long response, OpenThermResponseStatus status) {
+    bool valid = ot->isValidResponse(request, response);
+    bool decoded = field != nullptr && valid && OpenThermDecoder::decode(*field, response);
+
+    switch (id) {
+    case OpenThermMessageID::Status:
+      if (!updateBoilerStatus(request, response)) {
+        readiness.statusCount = 0;
+        Log.swarningln("OT", PSTR("Invalid response after setBoilerStatus: %s"), ot->statusToString(status));
 
-    // diag reset action
-    if (vars.actions.resetDiagnostic) {
-      if (vars.states.diagnostic) {
-        if (ot->sendServiceReset()) {
-          Log.sinfoln("OT", PSTR("Boiler diagnostic reset successfully"));
-          
-        } else {
-          Log.serrorln("OT", PSTR("Boiler diagnostic reset failed"));
+      } else {
+        if (readiness.statusCount < 255) {
+          readiness.statusCount++;
         }
+
       }
+      break;
 
-      vars.actions.resetDiagnostic = false;
-      yield();
-    }
+    case OpenThermMessageID::TSet:
+      if (valid) {
+        currentHeatingTemp = ot->getFloat(request);
+        rejectedHeatingTemp.active = false;
 
-    //
-    // Температура ГВС
-    byte newDhwTemp = settings.dhw.target;
-    if (settings.opentherm.dhwPresent && settings.dhw.enable && (needSetDhwTemp() || newDhwTemp != currentDhwTemp)) {
-      if (newDhwTemp < settings.dhw.minTemp || newDhwTemp > settings.dhw.maxTemp) {
-        newDhwTemp = constrain(newDhwTemp, settings.dhw.minTemp, settings.dhw.maxTemp);
+        if (vars.opentherm.startupTime == 0) {
+          vars.opentherm.startupTime = millis();
+          Log.sinfoln("OT.HEATING", PSTR("First set temp in %lu ms after start"), vars.opentherm.startupTime);
+        }
+
+      } else {
+        setRejected(rejectedHeatingTemp, request, response, status);
+        Log.swarningln("OT.HEATING", PSTR("Failed set temp"));
       }
+      break;
 
-      Log.sinfoln("OT.DHW", PSTR("Set temp = %u"), newDhwTemp);
+    case OpenThermMessageID::TsetCH2:
+      if (!valid) {
+        Log.swarningln(settings.opentherm.heatingCh1ToCh2 ? "OT.HEATING" : "OT.DHW", PSTR("Failed set ch2 temp"));
+      }
+      break;
 
-      // Записываем заданную температуру ГВС
-      if (ot->setDhwTemp(newDhwTemp)) {
-        currentDhwTemp = newDhwTemp;
-        dhwSetTempTime = millis();
+    case OpenThermMessageID::TdhwSet:
+      if (valid) {
+        currentDhwTemp = round(ot->getFloat(request));
 
       } else {
         Log.swarningln("OT.DHW", PSTR("Failed set temp"));
       }
+      break;
 
-      if (settings.opentherm.dhwToCh2) {
-        if (!ot->setHeatingCh2Temp(newDhwTemp)) {
-          Log.swarningln("OT.DHW", PSTR("Failed set ch2 temp"));
-        }
+    case OpenThermMessageID::Toutside:
+      // the outdoor sensor of the boiler is an input of the regulator
+      if (decoded) {
+        vars.actions.updateSetpoint = true;
       }
-    }
-
-    //
-    // Температура отопления
-    if (heatingEnabled && (needSetHeatingTemp() || fabs(vars.parameters.heatingSetpoint - currentHeatingTemp) > 0.0001)) {
-      Log.sinfoln("OT.HEATING", PSTR("Set temp = %u"), vars.parameters.heatingSetpoint);
+      break;
 
-      // Записываем заданную температуру
-      if (ot->setHeatingCh1Temp(vars.parameters.heatingSetpoint)) {
-        currentHeatingTemp = vars.parameters.heatingSetpoint;
-        heatingSetTempTime = millis();
+    case OpenThermMessageID::Tboiler:
+      if (decoded && vars.temperatures.heating > 0 && vars.temperatures.heating < 100) {
+        readiness.flowValid = true;
+      }
 
-      } else {
-        Log.swarningln("OT.HEATING", PSTR("Failed set temp"));
+      if (session.negotiated) {
+        // before the session state the member id was negotiated once per loop,
+        // the loop read every essential value once and ended with the flow temperature
+        session.savedTime += session.negotiationTime;
+        vars.opentherm.memberIdSavedPerHour = (unsigned long) ((uint64_t) session.savedTime * 3600000 / max(millis() - session.startTime, 1UL));
       }
+      break;
 
-      if (settings.opentherm.heatingCh1ToCh2) {
-        if (!ot->setHeatingCh2Temp(vars.parameters.heatingSetpoint)) {
-          Log.swarningln("OT.HEATING", PSTR("Failed set ch2 temp"));
-        }
+    case OpenThermMessageID::RelModLevel:
+      if (!vars.states.flame) {
+        vars.sensors.modulation = 0;
       }
-    }
+      break;
 
-    // коммутационная разность (hysteresis)
-    // только для pid и/или equitherm
-    if (settings.heating.hysteresis > 0 && !vars.states.emergency && (settings.equitherm.enable || settings.pid.enable)) {
-      float halfHyst = settings.heating.hysteresis / 2;
-      if (pump && vars.temperatures.indoor - settings.heating.target + 0.0001 >= halfHyst) {
-        pump = false;
+    case OpenThermMessageID::SlaveVersion:
+      if (decoded) {
+        Log.straceln("OT", PSTR("Slave type: %u, version: %u"), vars.parameters.slaveType, vars.parameters.slaveVersion);
+      }
+      break;
 
-      } else if (!pump && vars.temperatures.indoor - settings.heating.target - 0.0001 <= -(halfHyst)) {
-        pump = true;
+    case OpenThermMessageID::MasterVersion:
+      if (decoded) {
+        Log.straceln("OT", PSTR("Master type: %u, version: %u"), vars.parameters.masterType, vars.parameters.masterVersion);
       }
+      break;
 
-    } else if (!pump) {
-      pump = true;
-    }
-  }
+    case OpenThermMessageID::TdhwSetUBTdhwSetLB:
+      // DHW min/max temp
+      if (decoded) {
+        if (settings.dhw.minTemp < vars.parameters.dhwMinTemp) {
+          settings.dhw.minTemp = vars.parameters.dhwMinTemp;
+          eeSettings.update();
+          Log.snoticeln("OT.DHW", PSTR("Updated min temp: %d"), settings.dhw.minTemp);
+        }
 
-  void static sendRequestCallback(unsigned long request, unsigned long response, OpenThermResponseStatus status, byte attempt) {
-    printRequestDetail(ot->getDataID(request), status, request, response, attempt);
-  }
+        if (settings.dhw.maxTemp > vars.parameters.dhwMaxTemp) {
+          settings.dhw.maxTemp = vars.parameters.dhwMaxTemp;
+          eeSettings.update();
+          Log.snoticeln("OT.DHW", PSTR("Updated max temp: %d"), settings.dhw.maxTemp);
+        }
 
-  void static responseCallback(unsigned long result, OpenThermResponseStatus status) {
-    static byte attempt = 0;
+      } else {
+        Log.swarningln("OT.DHW", PSTR("Failed get min/max temp"));
+      }
 
-    switch (status) {
-    case OpenThermResponseStatus::TIMEOUT:
-      if (vars.states.otStatus && ++attempt > OPENTHERM_OFFLINE_TRESHOLD) {
-        vars.states.otStatus = false;
-        attempt = OPENTHERM_OFFLINE_TRESHOLD;
+      if (settings.dhw.minTemp >= settings.dhw.maxTemp) {
+        settings.dhw.minTemp = 30;
+        settings.dhw.maxTemp = 60;
+        eeSettings.update();
       }
       break;
 
-    case OpenThermResponseStatus::SUCCESS:
-      attempt = 0;
-      if (!vars.states.otStatus) {
-        vars.states.otStatus = true;
+    case OpenThermMessageID::MaxTSetUBMaxTSetLB:
+      // Heating min/max temp
+      if (decoded) {
+        if (settings.heating.minTemp < vars.parameters.heatingMinTemp) {
+          settings.heating.minTemp = vars.parameters.heatingMinTemp;
+          eeSettings.update();
+          Log.snoticeln("OT.HEATING", PSTR("Updated min temp: %d"), settings.heating.minTemp);
+        }
+
+        if (settings.heating.maxTemp > vars.parameters.heatingMaxTemp) {
+          settings.heating.maxTemp = vars.parameters.heatingMaxTemp;
+          eeSettings.update();
+          Log.snoticeln("OT.HEATING", PSTR("Updated max temp: %d"), settings.heating.maxTemp);
+        }
+
+      } else {
+        Log.swarningln("OT.HEATING", PSTR("Failed get min/max temp"));
       }
 
-      #ifdef LED_OT_RX_PIN
-      {
-        digitalWrite(LED_OT_RX_PIN, true);
-        unsigned long ts = millis();
-        while (millis() - ts < 2) {}
-        digitalWrite(LED_OT_RX_PIN, false);
+      if (settings.heating.minTemp >= settings.heating.maxTemp) {
+        settings.heating.minTemp = 20;
+        settings.heating.maxTemp = 90;
+        eeSettings.update();
       }
-      #endif
+
+      scheduler.force(OpenThermMessageID::MaxTSet);
       break;
 
     default:
@@ -323,32 +546,197 @@ protected:
     }
   }
 
+  // the frames of the thermostat only update the state of the boiler:
+  // the settings, the status pin and the own writes stay as they are
+  void handleGatewayResponse(unsigned long request, unsigned long response) {
+    if (!ot->isValidResponse(request, response)) {
+      return;
+    }
+
+    // the answers of the boiler confirm the link as the own polls do
+    OpenThermMessageID id = ot->getDataID(request);
+    if (id == OpenThermMessageID::Status) {
+      updateBoilerStates(response);
+
+      if (readiness.statusCount < 255) {
+        readiness.statusCount++;
+      }
+      return;
+    }
+
+    // the acknowledge of a write echoes the value of the thermostat
+    const OpenThermDataField* field = OpenThermDecoder::find(otGatewayFields, id);
+    if (field == nullptr || ot->getMessageType(response) != OpenThermMessageType::READ_ACK || !OpenThermDecoder::decode(*field, response)) {
+      return;
+    }
+
+    if (id == OpenThermMessageID::Toutside) {
+      vars.actions.updateSetpoint = true;
+
+    } else if (id == OpenThermMessageID::Tboiler && vars.temperatures.heating > 0 && vars.temperatures.heating < 100) {
+      readiness.flowValid = true;
+
+    } else if (id == OpenThermMessageID::RelModLevel && !vars.states.flame) {
+      vars.sensors.modulation = 0;
+    }
+  }
+
 protected:
-  unsigned short readyTime = 60000;
   unsigned short dhwSetTempInterval = 60000;
-  unsigned short heatingSetTempInterval = 60000;
 
+  OpenThermScheduler scheduler;
+  // by the index of the scheduler item
+  const OpenThermDataField* pollFields[OT_SCHEDULER_MAX_ITEMS] = {};
+  CustomOpenTherm::Request pollRequest;
+  int pollIndex = -1;
+  unsigned long pollTime = 0;
   bool pump = true;
-  unsigned long prevUpdateNonEssentialVars = 0;
+  bool heatingEnabled = false;
+  bool heatingCh2Enabled = false;
+  float currentHeatingTemp = 0;
+  byte currentDhwTemp = 0;
+  // values of the last forced writes, the heating one as on the wire
+  unsigned int forcedHeatingTemp = 0;
+  byte forcedDhwTemp = 0;
+
+  // value of a write which the boiler answered with DATA_INVALID or UNKNOWN_DATA_ID
+  struct RejectedWrite {
+    bool active = false;
+    unsigned int data = 0;
+    unsigned long ts = 0;
+  };
+  RejectedWrite rejectedHeatingTemp;
   unsigned long startupTime = millis();
-  unsigned long dhwSetTempTime = 0;
-  unsigned long heatingSetTempTime = 0;
+
+  // heating waits for a working link, at most OPENTHERM_READY_TIMEOUT
+  struct {
+    bool ready = false;
+    bool flowValid = false;
+    byte statusCount = 0;
+  } readiness;
+
+  CustomOpenTherm::Request probeRequest;
+  CustomOpenTherm::Request breakerRequest;
+  CustomOpenTherm::Request rawRequest;
+  unsigned long rawCost = 0;
+
+  // open while the link is down, the first status probe at boot goes at once
+  struct {
+    bool open = true;
+    bool pending = false;
+    unsigned long interval = 0;
+    unsigned long lastProbe = 0;
+  } breaker;
+
+  struct {
+    bool identified = false;
+    bool pending = false;
+    // next id in otProbeIds, otProbeCount - no sweep
+    byte index = otProbeCount;
+    // bit per index of otProbeIds: the ids of the current round and the ids without an answer in it
+    uint32_t roundIds = 0;
+    uint32_t retryIds = 0;
+    byte rounds = 0;
+    unsigned long lastIdentify = 0;
+    unsigned long startTime = 0;
+    unsigned long roundTime = 0;
+  } probe;
+
+  struct {
+    bool online = false;
+    bool negotiated = false;
+    unsigned int memberIdCode = 0;
+    // valid SConfigSMemberIDcode response of the session, 0 - not read
+    unsigned long slaveConfig = 0;
+    unsigned long lastNegotiation = 0;
+    // bus time of the last negotiation, ms
+    unsigned long negotiationTime = 0;
+    unsigned long startTime = 0;
+    unsigned long savedTime = 0;
+  } session;
+
+  // bus time of the blocking requests of sendRequest(), ms
+  unsigned long controlBusTime = 0;
 
 
   bool isReady() {
-    return millis() - startupTime > readyTime;
+    if (readiness.ready) {
+      return true;
+    }
+
+    bool linkReady = readiness.statusCount >= OPENTHERM_READY_STATUS_COUNT && readiness.flowValid;
+    if (!linkReady && millis() - startupTime < OPENTHERM_READY_TIMEOUT) {
+      return false;
+    }
+
+    readiness.ready = true;
+    vars.opentherm.readyTime = millis() - startupTime;
+
+    if (linkReady) {
+      Log.sinfoln("OT", PSTR("Ready in %lu ms"), vars.opentherm.readyTime);
+
+    } else {
+      Log.swarningln("OT", PSTR("Ready by timeout, link is not confirmed"));
+    }
+
+    return true;
+  }
+
+  bool isPollable(OpenThermMessageID id) {
+    // mandatory ids are always sent, only a rejected setpoint waits
+    if (id == OpenThermMessageID::Status) {
+      return true;
+    }
+
+    if (id == OpenThermMessageID::TSet) {
+      return !isRejected(rejectedHeatingTemp, ot->temperatureToData(vars.parameters.heatingSetpoint));
+    }
+
+    return otCapabilities.isPollable(id);
   }
 
-  bool needSetDhwTemp() {
-    return millis() - dhwSetTempTime > dhwSetTempInterval;
+  // a timeout or a corrupted frame says nothing about the value, only an answer of the boiler rejects it
+  void setRejected(RejectedWrite& rejected, unsigned long request, unsigned long response, OpenThermResponseStatus status) {
+    OpenThermMessageType type = ot->getMessageType(response);
+    if (status != OpenThermResponseStatus::INVALID || ot->getDataID(response) != ot->getDataID(request)
+      || (type != OpenThermMessageType::DATA_INVALID && type != OpenThermMessageType::UNKNOWN_DATA_ID)) {
+      return;
+    }
+
+    rejected.active = true;
+    rejected.data = request & 0xFFFF;
+    rejected.ts = millis();
+  }
+
+  bool isRejected(const RejectedWrite& rejected, unsigned int data) {
+    return rejected.active && rejected.data == data && millis() - rejected.ts < OPENTHERM_REJECTED_WRITE_INTERVAL;
   }
 
-  bool needSetHeatingTemp() {
-    return millis() - heatingSetTempTime > heatingSetTempInterval;
+  // compared as sent on the wire (f8.8), the float of the acknowledge is not exactly the setpoint
+  bool isHeatingSetpointChanged() {
+    return ot->temperatureToData(vars.parameters.heatingSetpoint) != ot->temperatureToData(currentHeatingTemp);
   }
 
-  void static printRequestDetail(OpenThermMessageID id, OpenThermResponseStatus status, unsigned long request, unsigned long response, byte attempt) {
-    Log.straceln("OT", PSTR("OT REQUEST ID: %4d   Request: %8lx   Response: %8lx   Attempt: %2d   Status: %s"), id, request, response, attempt, ot->statusToString(status));
+  byte getDhwTarget() {
+    return constrain(settings.dhw.target, settings.dhw.minTemp, settings.dhw.maxTemp);
+  }
+
+  // blocking exchange for the rare requests outside of the poll plan
+  unsigned long sendRequest(unsigned long request, byte attempts = 5) {
+    CustomOpenTherm::Request _request;
+    _request.request = request;
+    _request.attempts = attempts;
+
+    while (!otTransport.submit(OT_TRANSPORT_CONTROL, _request)) {
+      delay(5);
+    }
+
+    while (!_request.isDone()) {
+      delay(5);
+    }
+
+    controlBusTime += _request.busTime;
+    return _request.response;
   }
 
   bool setMasterMemberIdCode() {
@@ -362,8 +750,10 @@ protected:
     // с "кодом идентификатора участника", который идентифицирует производителя устройства.
     //=======================================================================================
 
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::SConfigSMemberIDcode, 0)); // 0xFFFF
-    if (ot->isValidResponse(response)) {
+    unsigned long response = sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::SConfigSMemberIDcode, 0)); // 0xFFFF
+    bool configValid = ot->isValidResponse(response);
+    if (configValid) {
+      session.slaveConfig = response;
       vars.parameters.slaveMemberIdCode = response & 0xFF;
 
       uint8_t flags = (response & 0xFFFF) >> 8;
@@ -405,11 +795,12 @@ protected:
       request |= responseFlags << 8;
     }
 
+    // nothing to write: the read of the slave config is the whole negotiation
     if (!request) {
-      return false;
+      return configValid;
     }
 
-    response = ot->sendRequest(ot->buildRequest(
+    response = sendRequest(ot->buildRequest(
       OpenThermRequestType::WRITE,
       OpenThermMessageID::MConfigMMemberIDcode,
       request
@@ -418,174 +809,261 @@ protected:
     return ot->isValidResponse(response);
   }
 
-  bool setMaxModulationLevel(byte value) {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::WRITE, OpenThermMessageID::MaxRelModLevelSetting, (unsigned int)(value * 256)));
-
-    return ot->isValidResponse(response);
-  }
+  void negotiateSession() {
+    unsigned long busTime = controlBusTime;
+    session.memberIdCode = settings.opentherm.memberIdCode;
+    session.negotiated = setMasterMemberIdCode();
+    session.lastNegotiation = millis();
 
-  bool setOpenThermVersionMaster() {
-    unsigned long response;
-    response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::OpenThermVersionSlave, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
+    if (!session.negotiated) {
+      Log.swarningln("OT", PSTR("Slave member id failed"));
+      return;
     }
 
-    response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::WRITE_DATA, OpenThermMessageID::OpenThermVersionMaster, response));
-    if (!ot->isValidResponse(response)) {
-      return false;
+    session.negotiationTime = controlBusTime - busTime;
+    if (session.startTime == 0) {
+      session.startTime = session.lastNegotiation;
     }
 
-    return true;
+    Log.straceln("OT", PSTR("Slave member id code: %u"), vars.parameters.slaveMemberIdCode);
+    Log.straceln("OT", PSTR("Master member id code: %u"), settings.opentherm.memberIdCode > 0 ? settings.opentherm.memberIdCode : vars.parameters.slaveMemberIdCode);
+    Log.straceln("OT", PSTR("Member id negotiated in %lu ms of the bus time"), session.negotiationTime);
   }
 
-  bool updateMasterParameters() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::WRITE, OpenThermMessageID::MasterVersion, 0x013F));
-    if (!ot->isValidResponse(response)) {
-      return false;
+  // member id and version of the slave are the key of the saved profile
+  void identifyBoiler() {
+    probe.lastIdentify = millis();
+
+    // the config is already read by the negotiation of the session
+    unsigned long config = session.slaveConfig;
+    if (config == 0) {
+      config = sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::SConfigSMemberIDcode, 0));
     }
 
-    vars.parameters.masterType = (response & 0xFFFF) >> 8;
-    vars.parameters.masterVersion = response & 0xFF;
+    if (!ot->isValidResponse(config)) {
+      Log.swarningln("OT", PSTR("Failed get slave config"));
+      return;
+    }
 
-    return true;
-  }
+    unsigned long version = sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::SlaveVersion, 0));
+    if (!ot->isValidResponse(version)) {
+      Log.swarningln("OT", PSTR("Failed get slave version"));
+      return;
+    }
 
-  bool updateSlaveParameters() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::SlaveVersion, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
+    probe.identified = true;
+    vars.parameters.slaveMemberIdCode = config & 0xFF;
+    vars.parameters.slaveFlags = (config >> 8) & 0xFF;
+    vars.parameters.slaveType = (version >> 8) & 0xFF;
+    vars.parameters.slaveVersion = version & 0xFF;
+
+    if (
+      boilerProfile.probed
+      && boilerProfile.slaveMemberIdCode == vars.parameters.slaveMemberIdCode
+      && boilerProfile.slaveType == vars.parameters.slaveType
+      && boilerProfile.slaveVersion == vars.parameters.slaveVersion
+    ) {
+      otCapabilities.load(boilerProfile.supported, boilerProfile.unsupported);
+      Log.sinfoln("OT", PSTR("Boiler profile restored, member id: %u, type: %u, version: %u"), vars.parameters.slaveMemberIdCode, vars.parameters.slaveType, vars.parameters.slaveVersion);
+      return;
     }
 
-    vars.parameters.slaveType = (response & 0xFFFF) >> 8;
-    vars.parameters.slaveVersion = response & 0xFF;
+    probe.index = 0;
+    probe.roundIds = otProbeCount < 32 ? (1UL << otProbeCount) - 1 : ~0UL;
+    probe.retryIds = 0;
+    probe.rounds = 0;
+    probe.startTime = millis();
+    probe.roundTime = millis();
+    Log.sinfoln("OT", PSTR("New boiler, member id: %u, type: %u, version: %u, probing %u ids"), vars.parameters.slaveMemberIdCode, vars.parameters.slaveType, vars.parameters.slaveVersion, otProbeCount);
+  }
 
-    return true;
+  // the first round goes at once, the next ones wait for the boiler which did not answer
+  bool isProbeDue() {
+    return probe.index < otProbeCount && (probe.rounds == 0 || millis() - probe.roundTime >= OPENTHERM_PROBE_RETRY_INTERVAL);
   }
 
-  bool updateMinMaxDhwTemp() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::TdhwSetUBTdhwSetLB, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
-    }
+  void submitProbe() {
+    probeRequest.request = ot->buildRequest(OpenThermRequestType::READ, otProbeIds[probe.index], 0);
+    probeRequest.attempts = 2;
 
-    byte minTemp = response & 0xFF;
-    byte maxTemp = (response & 0xFFFF) >> 8;
+    if (otTransport.submit(OT_TRANSPORT_CONTROL, probeRequest)) {
+      probe.pending = true;
+    }
+  }
 
-    if (minTemp >= 0 && maxTemp > 0 && maxTemp > minTemp) {
-      vars.parameters.dhwMinTemp = minTemp;
-      vars.parameters.dhwMaxTemp = maxTemp;
+  void handleProbeResponse() {
+    OpenThermMessageID id = otProbeIds[probe.index];
+    probe.pending = false;
 
-      return true;
+    // the link went down during the sweep: the answer says nothing about the id
+    if (!vars.states.otStatus) {
+      return;
     }
 
-    return false;
-  }
+    if (probeRequest.status == OpenThermResponseStatus::SUCCESS) {
+      otCapabilities.set(id, true);
 
-  bool updateMinMaxHeatingTemp() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::MaxTSetUBMaxTSetLB, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
-    }
+      // only the plain values: the poll handlers expect the requests of the poll plan
+      const OpenThermDataField* field = OpenThermDecoder::find(otDataFields, id);
+      if (field != nullptr) {
+        OpenThermDecoder::decode(*field, probeRequest.response);
+      }
 
-    byte minTemp = response & 0xFF;
-    byte maxTemp = (response & 0xFFFF) >> 8;
+    } else if (probeRequest.status == OpenThermResponseStatus::INVALID && ot->getMessageType(probeRequest.response) == OpenThermMessageType::UNKNOWN_DATA_ID) {
+      otCapabilities.set(id, false);
 
-    if (minTemp >= 0 && maxTemp > 0 && maxTemp > minTemp) {
-      vars.parameters.heatingMinTemp = minTemp;
-      vars.parameters.heatingMaxTemp = maxTemp;
-      return true;
+    } else if (probeRequest.status != OpenThermResponseStatus::INVALID || ot->getMessageType(probeRequest.response) != OpenThermMessageType::DATA_INVALID) {
+      // no answer: the id stays unknown and is asked again in the next round
+      probe.retryIds |= 1UL << probe.index;
     }
+    // DATA_INVALID: the id is known, its value is not available right now
 
-    return false;
-  }
+    // the next id of the round
+    do {
+      probe.index++;
+    } while (probe.index < otProbeCount && !(probe.roundIds & (1UL << probe.index)));
 
-  bool setMaxHeatingTemp(byte value) {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermMessageType::WRITE_DATA, OpenThermMessageID::MaxTSet, ot->temperatureToData(value)));
-    if (!ot->isValidResponse(response)) {
-      return false;
+    if (probe.index < otProbeCount) {
+      return;
     }
 
-    return true;
-  }
+    if (probe.retryIds != 0) {
+      if (++probe.rounds >= OPENTHERM_PROBE_ROUNDS) {
+        // the profile is not saved: the sweep is repeated when the link comes up again
+        Log.swarningln("OT", PSTR("Boiler probe stopped, ids without an answer: %08lx"), (unsigned long) probe.retryIds);
+        return;
+      }
 
-  bool updateOutsideTemp() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::Toutside, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
+      probe.roundIds = probe.retryIds;
+      probe.retryIds = 0;
+      probe.roundTime = millis();
+
+      probe.index = 0;
+      while (!(probe.roundIds & (1UL << probe.index))) {
+        probe.index++;
+      }
+
+      Log.sinfoln("OT", PSTR("Boiler probe, ids without an answer: %08lx, round %u"), (unsigned long) probe.roundIds, probe.rounds + 1);
+      return;
     }
 
-    vars.temperatures.outdoor = ot->getFloat(response) + settings.sensors.outdoor.offset;
-    return true;
+    boilerProfile.probed = true;
+    boilerProfile.slaveMemberIdCode = vars.parameters.slaveMemberIdCode;
+    boilerProfile.slaveType = vars.parameters.slaveType;
+    boilerProfile.slaveVersion = vars.parameters.slaveVersion;
+    boilerProfile.slaveFlags = vars.parameters.slaveFlags;
+    memcpy(boilerProfile.supported, otCapabilities.getSupported(), sizeof(boilerProfile.supported));
+    memcpy(boilerProfile.unsupported, otCapabilities.getUnsupported(), sizeof(boilerProfile.unsupported));
+    eeProfile.update();
+
+    vars.opentherm.probeTime = millis() - probe.startTime;
+    Log.sinfoln("OT", PSTR("Boiler probed in %lu ms"), vars.opentherm.probeTime);
   }
 
-  bool updateHeatingTemp() {
-    unsigned long response = ot->sendRequest(ot->buildGetBoilerTemperatureRequest());
-    if (!ot->isValidResponse(response)) {
-      return false;
+  // one raw frame at a time, only when no regular item of the poll plan is due during the frame,
+  // and within settings.opentherm.rawBudget
+  void handleRawFrames() {
+    if (rawRequest.state != CustomOpenTherm::RequestState::IDLE) {
+      if (!rawRequest.isDone()) {
+        return;
+      }
+
+      // without a response the slot took the whole timeout of 1 s
+      unsigned long cost = (rawRequest.status == OpenThermResponseStatus::TIMEOUT ? 1000 : ot->getLastLatency()) + ot->getFrameGap();
+      otRawBatch.complete(rawRequest.response, rawRequest.status, cost > rawCost ? cost - rawCost : 0);
+      rawRequest.state = CustomOpenTherm::RequestState::IDLE;
     }
 
-    vars.temperatures.heating = ot->getFloat(response);
-    return true;
-  }
+    if (!otRawBatch.isQueued()) {
+      return;
+    }
 
+    rawCost = (ot->getLatency() > 0 ? ot->getLatency() : 1000) + ot->getFrameGap();
 
-  bool updateDhwTemp() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermMessageType::READ, OpenThermMessageID::Tdhw, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
+    // the poll plan is stopped while the boiler does not answer and in the gateway mode,
+    // otherwise the window covers the raw frame and one regular frame which may wait behind it
+    bool polling = !breaker.open && !otGateway.isActive();
+    if (polling && (pollIndex >= 0 || probe.pending || !scheduler.isIdle(millis(), rawCost * 2))) {
+      return;
     }
 
-    vars.temperatures.dhw = ot->getFloat(response);
-    return true;
-  }
+    otRawBatch.setBudget(settings.opentherm.rawBudget);
+    OpenThermRawBatch::Frame* frame = otRawBatch.take(millis(), rawCost);
+    if (frame == nullptr) {
+      return;
+    }
 
-  bool updateDhwFlowRate() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermMessageType::READ, OpenThermMessageID::DHWFlowRate, 0));
-    if (!ot->isValidResponse(response)) {
-      return false;
+    rawRequest.request = frame->request;
+    rawRequest.attempts = 1;
+    // the queue is full: the frame is taken again by the next loop
+    if (!otTransport.submit(OT_TRANSPORT_CONTROL, rawRequest)) {
+      otRawBatch.release(rawCost);
     }
+  }
 
-    vars.sensors.dhwFlowRate = ot->getFloat(response);
-    return true;
+  void submitBreakerProbe() {
+    breakerRequest.request = buildPollRequest(OpenThermMessageID::Status);
+    breakerRequest.attempts = 1;
+
+    if (otTransport.submit(OT_TRANSPORT_CONTROL, breakerRequest)) {
+      breaker.pending = true;
+      breaker.lastProbe = millis();
+    }
   }
 
-  bool updateFaultCode() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::ASFflags, 0));
+  void handleBreakerResponse() {
+    breaker.pending = false;
 
-    if (!ot->isValidResponse(response)) {
-      return false;
+    if (breakerRequest.status == OpenThermResponseStatus::SUCCESS) {
+      // the link is up again, the transport has already seen the answer
+      handlePollResponse(OpenThermMessageID::Status, nullptr, breakerRequest.request, breakerRequest.response, breakerRequest.status);
+      return;
     }
 
-    vars.sensors.faultCode = response & 0xFF;
-    return true;
+    breaker.interval = min(max(breaker.interval * 2, (unsigned long) OPENTHERM_OFFLINE_PROBE_MIN), (unsigned long) OPENTHERM_OFFLINE_PROBE_MAX);
+    Log.straceln("OT", PSTR("Status probe failed, next in %lu ms"), breaker.interval);
   }
 
-  bool updateModulationLevel() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::RelModLevel, 0));
-
-    if (!ot->isValidResponse(response)) {
+  bool updateBoilerStatus(unsigned long request, unsigned long response) {
+    if (!ot->isValidResponse(request, response)) {
       return false;
     }
 
-    float modulation = ot->f88(response);
-    if (!vars.states.flame) {
-      vars.sensors.modulation = 0;
-    } else {
-      vars.sensors.modulation = modulation;
+    if (vars.parameters.heatingEnabled != heatingEnabled) {
+      vars.parameters.heatingEnabled = heatingEnabled;
+      vars.actions.updateSetpoint = true;
+      Log.sinfoln("OT.HEATING", "%s", heatingEnabled ? "Enabled" : "Disabled");
+
+      #ifdef HEATING_STATUS_PIN
+      digitalWrite(HEATING_STATUS_PIN, heatingEnabled);
+      #endif
     }
 
+    updateBoilerStates(response);
+
     return true;
   }
 
-  bool updatePressure() {
-    unsigned long response = ot->sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::CHPressure, 0));
+  void updateBoilerStates(unsigned long response) {
+    vars.states.heating = ot->isCentralHeatingActive(response);
+    vars.states.dhw = settings.opentherm.dhwPresent ? ot->isHotWaterActive(response) : false;
+    vars.states.flame = ot->isFlameOn(response);
+    vars.states.fault = ot->isFault(response);
+    vars.states.diagnostic = ot->isDiagnostic(response);
+  }
+
+  bool setOpenThermVersionMaster() {
+    unsigned long response;
+    response = sendRequest(ot->buildRequest(OpenThermRequestType::READ, OpenThermMessageID::OpenThermVersionSlave, 0));
+    if (!ot->isValidResponse(response)) {
+      return false;
+    }
 
+    response = sendRequest(ot->buildRequest(OpenThermRequestType::WRITE_DATA, OpenThermMessageID::OpenThermVersionMaster, response));
     if (!ot->isValidResponse(response)) {
       return false;
     }
 
-    vars.sensors.pressure = ot->getFloat(response);
     return true;
   }
 };
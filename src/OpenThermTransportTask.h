@@ -0,0 +1,206 @@
+#include <CustomOpenTherm.h>
+#include <OpenThermTransport.h>
+#include <OpenThermStats.h>
+#include <OpenThermTrace.h>
+#include <OpenThermGateway.h>
+#include <OpenThermBusMeter.h>
+
+CustomOpenTherm* ot;
+// thermostat side in the gateway mode
+CustomOpenTherm* otThermostat = nullptr;
+OpenThermTransport otTransport;
+OpenThermGateway otGateway;
+CustomOpenTherm::Request otGatewayRequest;
+// request of the thermostat waits for the bus
+volatile bool otGatewayReceived = false;
+OpenThermStats otStats;
+OpenThermTrace otTrace;
+OpenThermBusMeter otBusMeter;
+
+// response counters for the activity led, written by the transport task only
+struct {
+  volatile unsigned long success = 0;
+  volatile unsigned long errors = 0;
+} otActivity;
+extern Variables vars;
+extern Settings settings;
+extern TinyLogger Log;
+
+
+// Owns the bus: other tasks only submit requests to otTransport and never touch the wire.
+class OpenThermTransportTask : public Task {
+public:
+  OpenThermTransportTask(bool _enabled = false, unsigned long _interval = 0) : Task(_enabled, _interval) {}
+
+  void static IRAM_ATTR handleInterrupt() {
+    ot->handleInterrupt();
+  }
+
+  void static IRAM_ATTR handleThermostatInterrupt() {
+    otThermostat->handleInterrupt();
+  }
+
+protected:
+  const char* getTaskName() {
+    return "OpenTherm.Transport";
+  }
+  
+  int getTaskCore() {
+    return 1;
+  }
+
+  void setup() {
+    #if defined(ESP32)
+      // frame timing must not wait behind wifi/mqtt work
+      vTaskPrioritySet(NULL, OPENTHERM_TRANSPORT_PRIORITY);
+    #endif
+
+    ot = new CustomOpenTherm(settings.opentherm.inPin, settings.opentherm.outPin);
+
+    ot->setHandleSendRequestCallback(this->sendRequestCallback);
+    ot->begin(OpenThermTransportTask::handleInterrupt, this->responseCallback);
+
+    if (settings.opentherm.gateway && isValidGatewayPins()) {
+      otThermostat = new CustomOpenTherm(settings.opentherm.gatewayInPin, settings.opentherm.gatewayOutPin, true);
+      otThermostat->begin(OpenThermTransportTask::handleThermostatInterrupt, this->thermostatRequestCallback);
+
+      otGatewayRequest.attempts = 1;
+      otGatewayRequest.completeCallback = this->gatewayResponseCallback;
+      otGateway.setActive(true);
+
+      Log.sinfoln("OT.GW", PSTR("Started, thermostat pins: %u, %u"), settings.opentherm.gatewayInPin, settings.opentherm.gatewayOutPin);
+    }
+  }
+
+  void loop() {
+    if (otThermostat != nullptr) {
+      ot->setPacingMode(CustomOpenTherm::PacingMode::GATEWAY);
+      updateOverrides();
+
+      // the request of the thermostat goes first, it waits for the answer at most 800 ms
+      otThermostat->process();
+      if (otGatewayReceived && ot->sendRequestAsync(otGatewayRequest)) {
+        otGatewayReceived = false;
+      }
+
+    } else {
+      ot->setPacingMode(settings.opentherm.adaptivePacing ? CustomOpenTherm::PacingMode::ADAPTIVE : CustomOpenTherm::PacingMode::FIXED);
+    }
+
+    ot->setWriteKeepAlive(settings.opentherm.writeKeepAlive * 1000UL);
+    ot->tick();
+
+    if (!otGateway.isPending()) {
+      otTransport.dispatch(ot);
+    }
+
+    if (otBusMeter.update(millis())) {
+      otBusMeter.getAverage(vars.opentherm.busTx, vars.opentherm.busRx, vars.opentherm.busGap, vars.opentherm.busRetry);
+    }
+
+    delay(ot->isBusy() || otThermostat != nullptr ? 2 : 5);
+  }
+
+  bool isValidGatewayPins() {
+    byte pins[] = {settings.opentherm.inPin, settings.opentherm.outPin, settings.opentherm.gatewayInPin, settings.opentherm.gatewayOutPin};
+
+    for (byte i = 0; i < 4; i++) {
+      for (byte j = i + 1; j < 4; j++) {
+        if (pins[i] == pins[j]) {
+          return false;
+        }
+      }
+    }
+
+    return settings.opentherm.gatewayInPin > 0 && settings.opentherm.gatewayOutPin > 0;
+  }
+
+  void updateOverrides() {
+    // the regulator of the gateway replaces the flow temperature of the thermostat
+    if (settings.opentherm.overrideTSet && settings.heating.enable) {
+      otGateway.setOverride(OpenThermMessageID::TSet, ot->temperatureToData(vars.parameters.heatingSetpoint));
+
+    } else {
+      otGateway.clearOverride(OpenThermMessageID::TSet);
+    }
+
+    if (settings.opentherm.overrideMaxModulation) {
+      otGateway.setOverride(OpenThermMessageID::MaxRelModLevelSetting, (unsigned int) settings.heating.maxModulation << 8);
+
+    } else {
+      otGateway.clearOverride(OpenThermMessageID::MaxRelModLevelSetting);
+    }
+  }
+
+  void static thermostatRequestCallback(unsigned long request, OpenThermResponseStatus status) {
+    if (status != OpenThermResponseStatus::SUCCESS) {
+      Log.swarningln("OT.GW", PSTR("Invalid request from thermostat: %8lx"), request);
+      return;
+    }
+
+    // the previous request is on the wire: this one is dropped, a request which still waits for the bus is replaced
+    if (otGateway.isPending() && !otGatewayReceived) {
+      otGateway.skipRequest();
+      return;
+    }
+
+    otGatewayRequest.request = otGateway.handleRequest(request, millis());
+    otGatewayReceived = true;
+  }
+
+  void static gatewayResponseCallback(CustomOpenTherm::Request* request, void*) {
+    unsigned long response = otGateway.handleResponse(request->request, request->response, request->status, ot->getLastLatency(), millis());
+    if (response != 0) {
+      otThermostat->sendResponse(response);
+    }
+
+    vars.opentherm.gatewayLatency = otGateway.getLatency();
+    vars.opentherm.gatewayOverhead = otGateway.getOverhead();
+    vars.opentherm.gatewayMaxLatency = otGateway.getMaxLatency();
+  }
+
+  void static sendRequestCallback(unsigned long request, unsigned long response, OpenThermResponseStatus status, byte attempt) {
+    otTrace.record(request, response, status, attempt);
+    otStats.handleAttempt(request, status, attempt, ot->getLastLatency());
+    otBusMeter.handleAttempt(ot->getLastAttemptTime(), ot->getLastGap(), attempt > 1, millis());
+
+    if (settings.debug) {
+      printRequestDetail(ot->getDataID(request), status, request, response, attempt);
+    }
+  }
+
+  void static responseCallback(unsigned long, OpenThermResponseStatus status) {
+    static byte attempt = 0;
+
+    switch (status) {
+    case OpenThermResponseStatus::TIMEOUT:
+      otActivity.errors++;
+
+      if (vars.states.otStatus && ++attempt > OPENTHERM_OFFLINE_TRESHOLD) {
+        vars.states.otStatus = false;
+        attempt = OPENTHERM_OFFLINE_TRESHOLD;
+      }
+      break;
+
+    case OpenThermResponseStatus::SUCCESS:
+      attempt = 0;
+      if (!vars.states.otStatus) {
+        vars.states.otStatus = true;
+      }
+
+      otActivity.success++;
+      break;
+
+    case OpenThermResponseStatus::INVALID:
+      otActivity.errors++;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  void static printRequestDetail(OpenThermMessageID id, OpenThermResponseStatus status, unsigned long request, unsigned long response, byte attempt) {
+    Log.straceln("OT", PSTR("OT REQUEST ID: %4d   Request: %8lx   Response: %8lx   Attempt: %2d   Status: %s"), id, request, response, attempt, ot->statusToString(status));
+  }
+};
@@ -1,14 +1,17 @@
 #include <Equitherm.h>
 #include <GyverPID.h>
 #include <PIDtuner.h>
+#include <EquithermTuner.h>
 
 extern Variables vars;
 extern Settings settings;
 extern TinyLogger Log;
+extern EEManager eeSettings;
 
 Equitherm etRegulator;
 GyverPID pidRegulator(0, 0, 0);
 PIDtuner pidTuner;
+EquithermTuner etTuner;
 
 
 class RegulatorTask : public LeanTask {
@@ -23,6 +26,12 @@ protected:
   float prevEtResult = 0;
   float prevPidResult = 0;
 
+  // the setpoint is recalculated when an input changes (vars.actions.updateSetpoint)
+  // and with the step of the PID and the tuner, their integrals count calls, not time
+  unsigned long lastStepTime = 0;
+  bool stepStarted = false;
+  bool stepDue = false;
+
   const char* getTaskName() {
     return "Regulator";
   }
@@ -32,7 +41,19 @@ protected:
   }
   
   void loop() {
-    byte newTemp = vars.parameters.heatingSetpoint;
+    stepDue = !stepStarted || millis() - lastStepTime >= REGULATOR_STEP_INTERVAL;
+    if (!stepDue && !vars.actions.updateSetpoint) {
+      return;
+    }
+
+    // cleared before the inputs are read: a change during the calculation is not lost
+    vars.actions.updateSetpoint = false;
+    if (stepDue) {
+      lastStepTime = millis();
+      stepStarted = true;
+    }
+
+    float newTemp = vars.parameters.heatingSetpoint;
 
     if (vars.states.emergency) {
       if (settings.heating.turbo) {
@@ -44,7 +65,7 @@ protected:
       newTemp = getEmergencyModeTemp();
 
     } else {
-      if (vars.tuning.enable || tunerInit) {
+      if ((vars.tuning.enable || tunerInit) && stepDue) {
         if (settings.heating.turbo) {
           settings.heating.turbo = false;
 
@@ -69,32 +90,33 @@ protected:
       }
     }
 
-    // Ограничиваем, если до этого не ограничило
-    if (newTemp < settings.heating.minTemp || newTemp > settings.heating.maxTemp) {
-      newTemp = constrain(newTemp, settings.heating.minTemp, settings.heating.maxTemp);
+    // Квантуем с заданным шагом
+    if (settings.heating.setpointStep > 0) {
+      newTemp = round(newTemp / settings.heating.setpointStep) * settings.heating.setpointStep;
     }
 
-    if (abs(vars.parameters.heatingSetpoint - newTemp) + 0.0001 >= 1) {
-      vars.parameters.heatingSetpoint = newTemp;
+    // Зона нечувствительности только для итоговой уставки
+    if (fabs(vars.parameters.heatingSetpoint - newTemp) + 0.0001 < settings.heating.setpointDeadband) {
+      newTemp = vars.parameters.heatingSetpoint;
     }
+
+    // Ограничиваем всегда: пределы могли измениться и для удержанной уставки
+    vars.parameters.heatingSetpoint = constrain(newTemp, settings.heating.minTemp, settings.heating.maxTemp);
   }
 
 
-  byte getEmergencyModeTemp() {
+  float getEmergencyModeTemp() {
     float newTemp = 0;
 
     // if use equitherm
     if (settings.emergency.useEquitherm && settings.sensors.outdoor.type != 1) {
       float etResult = getEquithermTemp(settings.heating.minTemp, settings.heating.maxTemp);
+      newTemp += etResult;
 
-      if (fabs(prevEtResult - etResult) + 0.0001 >= 0.5) {
+      // the deadband applies to the final setpoint, here it only limits the log
+      if (fabs(prevEtResult - etResult) + 0.0001 >= settings.heating.setpointDeadband) {
         prevEtResult = etResult;
-        newTemp += etResult;
-
         Log.sinfoln("REGULATOR.EQUITHERM", PSTR("New emergency result: %u (%f)"), (int) round(etResult), etResult);
-
-      } else {
-        newTemp += prevEtResult;
       }
 
     } else {
@@ -102,10 +124,10 @@ protected:
       newTemp = settings.emergency.target;
     }
 
-    return round(newTemp);
+    return newTemp;
   }
 
-  byte getNormalModeTemp() {
+  float getNormalModeTemp() {
     float newTemp = 0;
 
     if (fabs(prevHeatingTarget - settings.heating.target) > 0.0001) {
@@ -121,36 +143,29 @@ protected:
     // if use equitherm
     if (settings.equitherm.enable) {
       float etResult = getEquithermTemp(settings.heating.minTemp, settings.heating.maxTemp);
+      newTemp += etResult;
 
-      if (fabs(prevEtResult - etResult) + 0.0001 >= 0.5) {
+      if (fabs(prevEtResult - etResult) + 0.0001 >= settings.heating.setpointDeadband) {
         prevEtResult = etResult;
-        newTemp += etResult;
-
         Log.sinfoln("REGULATOR.EQUITHERM", PSTR("New result: %u (%f)"), (int) round(etResult), etResult);
-
-      } else {
-        newTemp += prevEtResult;
       }
     }
 
-    // if use pid
-    if (settings.pid.enable && vars.parameters.heatingEnabled) {
+    // if use pid, between the steps its last result
+    if (settings.pid.enable && vars.parameters.heatingEnabled && stepDue) {
       float pidResult = getPidTemp(
         settings.equitherm.enable ? (settings.pid.maxTemp * -1) : settings.pid.minTemp,
         settings.equitherm.enable ? settings.pid.maxTemp : settings.pid.maxTemp
       );
 
-      if (fabs(prevPidResult - pidResult) + 0.0001 >= 0.5) {
-        prevPidResult = pidResult;
-        newTemp += pidResult;
-
+      if (fabs(prevPidResult - pidResult) + 0.0001 >= settings.heating.setpointDeadband) {
         Log.sinfoln("REGULATOR.PID", PSTR("New result: %d (%f)"), (int) round(pidResult), pidResult);
-
-      } else {
-        newTemp += prevPidResult;
       }
 
-    } else if (settings.pid.enable && !vars.parameters.heatingEnabled && prevPidResult != 0) {
+      prevPidResult = pidResult;
+    }
+
+    if (settings.pid.enable) {
       newTemp += prevPidResult;
     }
 
@@ -159,14 +174,17 @@ protected:
       newTemp = settings.heating.target;
     }
 
-    newTemp = round(newTemp);
     newTemp = constrain(newTemp, 0, 100);
     return newTemp;
   }
 
-  byte getTuningModeTemp() {
+  float getTuningModeTemp() {
     if (tunerInit && (!vars.tuning.enable || vars.tuning.regulator != tunerRegulator)) {
       if (tunerRegulator == 0) {
+        etTuner.reset();
+        vars.tuning.state = etTuner.getState();
+
+      } else if (tunerRegulator == 1) {
         pidTuner.reset();
       }
 
@@ -182,9 +200,52 @@ protected:
 
 
     if (vars.tuning.regulator == 0) {
-      // @TODO дописать
-      Log.sinfoln("REGULATOR.TUNING.EQUITHERM", PSTR("Not implemented"));
-      return 0;
+      // Equitherm tuner
+      if (!settings.equitherm.enable) {
+        Log.swarningln("REGULATOR.TUNING.EQUITHERM", PSTR("Equitherm is disabled"));
+        return 0;
+      }
+
+      if (!tunerInit) {
+        etTuner.start(settings.equitherm.n_factor, settings.equitherm.k_factor, millis());
+        tunerInit = true;
+        tunerRegulator = 0;
+        Log.sinfoln("REGULATOR.TUNING.EQUITHERM", PSTR("Started. N: %f, K: %f"), settings.equitherm.n_factor, settings.equitherm.k_factor);
+      }
+
+      if (etTuner.update(vars.temperatures.indoor, vars.temperatures.outdoor, settings.heating.target, millis())) {
+        settings.equitherm.n_factor = round(etTuner.getKn() * 1000) / 1000;
+        settings.equitherm.k_factor = round(etTuner.getKk() * 100) / 100;
+        eeSettings.update();
+
+        Log.sinfoln(
+          "REGULATOR.TUNING.EQUITHERM", PSTR("Step %u, error: %f, new N: %f, K: %f"),
+          etTuner.getSteps(), etTuner.getError(), settings.equitherm.n_factor, settings.equitherm.k_factor
+        );
+      }
+
+      vars.tuning.state = etTuner.getState();
+      vars.tuning.factor = etTuner.getFactor();
+      vars.tuning.progress = etTuner.getProgress(millis());
+      vars.tuning.steps = etTuner.getSteps();
+      vars.tuning.converged = etTuner.getConverged();
+      vars.tuning.error = etTuner.getError();
+
+      if (etTuner.getState() == EquithermTuner::FINISHED) {
+        if (etTuner.isConverged()) {
+          Log.sinfoln("REGULATOR.TUNING.EQUITHERM", PSTR("Finished. N: %f, K: %f"), settings.equitherm.n_factor, settings.equitherm.k_factor);
+
+        } else {
+          Log.swarningln("REGULATOR.TUNING.EQUITHERM", PSTR("Finished without convergence, error: %f"), etTuner.getError());
+        }
+
+        tunerInit = false;
+        tunerRegulator = 0;
+        return 0;
+      }
+
+      // the curve alone: the T correction would hide the error of the curve
+      return getEquithermTemp(settings.heating.minTemp, settings.heating.maxTemp, false);
 
     } else if (vars.tuning.regulator == 1) {
       // PID tuner
@@ -244,15 +305,15 @@ protected:
         tunerState = pidTuner.getState();
       }
 
-      return round(defaultTemp + pidTuner.getOutput());
+      return defaultTemp + pidTuner.getOutput();
 
     } else {
       return 0;
     }
   }
 
-  float getEquithermTemp(int minTemp, int maxTemp) {
-    if (vars.states.emergency) {
+  float getEquithermTemp(int minTemp, int maxTemp, bool correction = true) {
+    if (vars.states.emergency || !correction) {
       etRegulator.Kt = 0;
       etRegulator.indoorTemp = 0;
       etRegulator.outdoorTemp = vars.temperatures.outdoor;
@@ -274,11 +335,10 @@ protected:
 
     etRegulator.setLimits(minTemp, maxTemp);
     etRegulator.Kn = settings.equitherm.n_factor;
-    // etRegulator.Kn = tuneEquithermN(etRegulator.Kn, vars.temperatures.indoor, settings.heating.target, 300, 1800, 0.01, 1);
     etRegulator.Kk = settings.equitherm.k_factor;
     etRegulator.targetTemp = vars.states.emergency ? settings.emergency.target : settings.heating.target;
 
-    return etRegulator.getResult();
+    return (float) etRegulator.getResult();
   }
 
   float getPidTemp(int minTemp, int maxTemp) {
@@ -293,31 +353,4 @@ protected:
     return pidRegulator.getResultNow();
   }
 
-  float tuneEquithermN(float ratio, float currentTemp, float setTemp, unsigned int dirtyInterval = 60, unsigned int accurateInterval = 1800, float accurateStep = 0.01, float accurateStepAfter = 1) {
-    static uint32_t _prevIteration = millis();
-
-    if (abs(currentTemp - setTemp) < accurateStepAfter) {
-      if (millis() - _prevIteration < (accurateInterval * 1000)) {
-        return ratio;
-      }
-
-      if (currentTemp - setTemp > 0.1f) {
-        ratio -= accurateStep;
-
-      } else if (currentTemp - setTemp < -0.1f) {
-        ratio += accurateStep;
-      }
-
-    } else {
-      if (millis() - _prevIteration < (dirtyInterval * 1000)) {
-        return ratio;
-      }
-
-      ratio = ratio * (setTemp / currentTemp);
-    }
-
-    _prevIteration = millis();
-    return ratio;
-  }
-
 };
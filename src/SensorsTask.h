@@ -89,6 +89,7 @@ protected:
 
       if (fabs(vars.temperatures.outdoor - filteredOutdoorTemp) > 0.099) {
         vars.temperatures.outdoor = filteredOutdoorTemp + settings.sensors.outdoor.offset;
+        vars.actions.updateSetpoint = true;
         Log.sinfoln("SENSORS.OUTDOOR", PSTR("New temp: %f"), filteredOutdoorTemp);
       }
     }
@@ -146,6 +147,7 @@ protected:
 
       if (fabs(vars.temperatures.indoor - filteredIndoorTemp) > 0.099) {
         vars.temperatures.indoor = filteredIndoorTemp + settings.sensors.indoor.offset;
+        vars.actions.updateSetpoint = true;
         Log.sinfoln("SENSORS.INDOOR", PSTR("New temp: %f"), filteredIndoorTemp);
       }
     }
@@ -17,6 +17,14 @@ CheckboxParameter* wmOtHeatingCh2Enabled;
 CheckboxParameter* wmOtHeatingCh1ToCh2;
 CheckboxParameter* wmOtDhwToCh2;
 CheckboxParameter* wmOtDhwBlocking;
+CheckboxParameter* wmOtAdaptivePacing;
+UnsignedIntParameter* wmOtWriteKeepAlive;
+UnsignedIntParameter* wmOtRawBudget;
+CheckboxParameter* wmOtGateway;
+UnsignedIntParameter* wmOtGatewayInPin;
+UnsignedIntParameter* wmOtGatewayOutPin;
+CheckboxParameter* wmOtOverrideTSet;
+CheckboxParameter* wmOtOverrideMaxModulation;
 UnsignedIntParameter* wmOutdoorSensorPin;
 UnsignedIntParameter* wmIndoorSensorPin;
 
@@ -116,6 +124,30 @@ void WifiManagerTask::setup()
   wmOtDhwBlocking = new CheckboxParameter("ot_dhw_blocking", "Opentherm DHW blocking", settings.opentherm.dhwBlocking);
   wm.addParameter(wmOtDhwBlocking);
 
+  wmOtAdaptivePacing = new CheckboxParameter("ot_adaptive_pacing", "Opentherm adaptive pacing", settings.opentherm.adaptivePacing);
+  wm.addParameter(wmOtAdaptivePacing);
+
+  wmOtWriteKeepAlive = new UnsignedIntParameter("ot_write_keep_alive", "Opentherm write keep-alive, sec", settings.opentherm.writeKeepAlive, 4);
+  wm.addParameter(wmOtWriteKeepAlive);
+
+  wmOtRawBudget = new UnsignedIntParameter("ot_raw_budget", "Opentherm raw frames bus time, %", settings.opentherm.rawBudget, 3);
+  wm.addParameter(wmOtRawBudget);
+
+  wmOtGateway = new CheckboxParameter("ot_gateway", "Opentherm gateway mode (thermostat pass-through)", settings.opentherm.gateway);
+  wm.addParameter(wmOtGateway);
+
+  wmOtGatewayInPin = new UnsignedIntParameter("ot_gateway_in_pin", "Opentherm thermostat GPIO IN", settings.opentherm.gatewayInPin, 2);
+  wm.addParameter(wmOtGatewayInPin);
+
+  wmOtGatewayOutPin = new UnsignedIntParameter("ot_gateway_out_pin", "Opentherm thermostat GPIO OUT", settings.opentherm.gatewayOutPin, 2);
+  wm.addParameter(wmOtGatewayOutPin);
+
+  wmOtOverrideTSet = new CheckboxParameter("ot_override_tset", "Opentherm gateway: override heating temp", settings.opentherm.overrideTSet);
+  wm.addParameter(wmOtOverrideTSet);
+
+  wmOtOverrideMaxModulation = new CheckboxParameter("ot_override_max_modulation", "Opentherm gateway: override max modulation", settings.opentherm.overrideMaxModulation);
+  wm.addParameter(wmOtOverrideMaxModulation);
+
   wmSep2 = new SeparatorParameter();
   wm.addParameter(wmSep2);
 
@@ -340,6 +372,57 @@ void WifiManagerTask::saveParamsCallback()
     settings.opentherm.dhwBlocking = wmOtDhwBlocking->getCheckboxValue();
   }
 
+  if (wmOtAdaptivePacing->getCheckboxValue() != settings.opentherm.adaptivePacing)
+  {
+    changed = true;
+    settings.opentherm.adaptivePacing = wmOtAdaptivePacing->getCheckboxValue();
+  }
+
+  if (wmOtWriteKeepAlive->getValue() != settings.opentherm.writeKeepAlive)
+  {
+    changed = true;
+    settings.opentherm.writeKeepAlive = wmOtWriteKeepAlive->getValue();
+  }
+
+  if (wmOtRawBudget->getValue() != settings.opentherm.rawBudget)
+  {
+    changed = true;
+    settings.opentherm.rawBudget = min(wmOtRawBudget->getValue(), 100u);
+  }
+
+  if (wmOtGateway->getCheckboxValue() != settings.opentherm.gateway)
+  {
+    changed = true;
+    needRestart = true;
+    settings.opentherm.gateway = wmOtGateway->getCheckboxValue();
+  }
+
+  if (wmOtGatewayInPin->getValue() != settings.opentherm.gatewayInPin)
+  {
+    changed = true;
+    needRestart = true;
+    settings.opentherm.gatewayInPin = wmOtGatewayInPin->getValue();
+  }
+
+  if (wmOtGatewayOutPin->getValue() != settings.opentherm.gatewayOutPin)
+  {
+    changed = true;
+    needRestart = true;
+    settings.opentherm.gatewayOutPin = wmOtGatewayOutPin->getValue();
+  }
+
+  if (wmOtOverrideTSet->getCheckboxValue() != settings.opentherm.overrideTSet)
+  {
+    changed = true;
+    settings.opentherm.overrideTSet = wmOtOverrideTSet->getCheckboxValue();
+  }
+
+  if (wmOtOverrideMaxModulation->getCheckboxValue() != settings.opentherm.overrideMaxModulation)
+  {
+    changed = true;
+    settings.opentherm.overrideMaxModulation = wmOtOverrideMaxModulation->getCheckboxValue();
+  }
+
   if (wmOutdoorSensorPin->getValue() != settings.sensors.outdoor.pin)
   {
     changed = true;
@@ -382,6 +465,14 @@ void WifiManagerTask::saveParamsCallback()
            "  OT heating ch1 to ch2: %d\r\n"
            "  OT DHW to ch2: %d\r\n"
            "  OT DHW blocking: %d\r\n"
+           "  OT adaptive pacing: %d\r\n"
+           "  OT write keep-alive: %d\r\n"
+           "  OT raw frames bus time: %d\r\n"
+           "  OT gateway: %d\r\n"
+           "  OT gateway in pin: %d\r\n"
+           "  OT gateway out pin: %d\r\n"
+           "  OT gateway override heating temp: %d\r\n"
+           "  OT gateway override max modulation: %d\r\n"
            "  Outdoor sensor pin: %d\r\n"
            "  Indoor sensor pin: %d\r\n"),
       settings.hostname,
@@ -400,6 +491,14 @@ void WifiManagerTask::saveParamsCallback()
       settings.opentherm.heatingCh1ToCh2,
       settings.opentherm.dhwToCh2,
       settings.opentherm.dhwBlocking,
+      settings.opentherm.adaptivePacing,
+      settings.opentherm.writeKeepAlive,
+      settings.opentherm.rawBudget,
+      settings.opentherm.gateway,
+      settings.opentherm.gatewayInPin,
+      settings.opentherm.gatewayOutPin,
+      settings.opentherm.overrideTSet,
+      settings.opentherm.overrideMaxModulation,
       settings.sensors.outdoor.pin,
       settings.sensors.indoor.pin);
 
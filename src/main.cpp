@@ -18,6 +18,7 @@
 #include <LeanTask.h>
 #include "WifiManagerTask.h"
 #include "MqttTask.h"
+#include "OpenThermTransportTask.h"
 #include "OpenThermTask.h"
 #include "SensorsTask.h"
 #include "RegulatorTask.h"
@@ -25,9 +26,11 @@
 
 Variables vars;
 Settings settings;
+BoilerProfile boilerProfile;
 
 // Vars
 EEManager eeSettings(settings, 60000);
+EEManager eeProfile(boilerProfile, 60000);
 #if USE_TELNET
   ESPTelnetStream TelnetStream;
 #endif
@@ -35,6 +38,7 @@ EEManager eeSettings(settings, 60000);
 // Tasks
 WifiManagerTask* tWm;
 MqttTask* tMqtt;
+OpenThermTransportTask* tOtTransport;
 OpenThermTask* tOt;
 SensorsTask* tSensors;
 RegulatorTask* tRegulator;
@@ -57,7 +61,7 @@ void setup() {
   #endif
   //Log.setNtpClient(&timeClient);
 
-  EEPROM.begin(eeSettings.blockSize());
+  EEPROM.begin(eeSettings.blockSize() + eeProfile.blockSize());
   uint8_t eeSettingsResult = eeSettings.begin(0, 's');
   if (eeSettingsResult == 0) {
     Log.sinfoln("MAIN", PSTR("Settings loaded"));
@@ -76,19 +80,37 @@ void setup() {
     Log.serrorln("MAIN", PSTR("Settings NOT loaded (error)"));
   }
 
+  uint8_t eeProfileResult = eeProfile.begin(eeSettings.nextAddr(), 'p');
+  if (eeProfileResult == 0) {
+    if (strcmp(PROFILE_VALID_VALUE, boilerProfile.validationValue) != 0) {
+      Log.swarningln("MAIN", PSTR("Boiler profile not valid, reset"));
+      boilerProfile = BoilerProfile();
+      eeProfile.updateNow();
+
+    } else if (boilerProfile.probed) {
+      Log.sinfoln("MAIN", PSTR("Boiler profile loaded"));
+    }
+
+  } else if (eeProfileResult == 2) {
+    Log.serrorln("MAIN", PSTR("Boiler profile NOT loaded (error)"));
+  }
+
   tWm = new WifiManagerTask(true);
   Scheduler.start(tWm);
 
   tMqtt = new MqttTask(false);
   Scheduler.start(tMqtt);
 
+  tOtTransport = new OpenThermTransportTask(false);
+  Scheduler.start(tOtTransport);
+
   tOt = new OpenThermTask(false);
   Scheduler.start(tOt);
 
   tSensors = new SensorsTask(true, EXT_SENSORS_INTERVAL);
   Scheduler.start(tSensors);
 
-  tRegulator = new RegulatorTask(true, 10000);
+  tRegulator = new RegulatorTask(true, REGULATOR_WAKE_INTERVAL);
   Scheduler.start(tRegulator);
 
   tMain = new MainTask(true, 10);